@@ -0,0 +1,88 @@
+// Real FFT throughput per backend at the sizes the pipeline uses: the two STFT resolutions
+// (1024, 2048) and the largest zero-padded ACF (16384). items_per_second is transforms/s.
+//   master_tempo_bench --benchmark_filter=Fft
+
+#include <JuceHeader.h>
+#include <benchmark/benchmark.h>
+#include "dsp/FftBackend.h"
+#include "dsp/FluxKernel.h"
+#include <random>
+
+namespace
+{
+    AlignedFloatVector makeInput(int size)
+    {
+        AlignedFloatVector data((size_t) size * 2, 0.0f);
+        std::mt19937 rng(99u);
+        std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+        for (int i = 0; i < size; ++i)
+            data[(size_t) i] = dist(rng);
+        return data;
+    }
+
+    // Skips (rather than silently benchmarking JUCE twice) when the backend is not built in
+    std::unique_ptr<RealFft> makePlan(benchmark::State& state, FftBackend backend, int order)
+    {
+        auto plan = createRealFft(backend, order);
+        if (plan->getBackend() != backend)
+        {
+            state.SkipWithError("backend not available in this build");
+            return nullptr;
+        }
+        state.SetLabel(backend == FftBackend::Pffft ? "pffft" : "juce");
+        return plan;
+    }
+
+    void fftArgs(benchmark::internal::Benchmark* b)
+    {
+        b->ArgNames({ "backend", "order" });
+        for (int backend : { (int) FftBackend::Juce, (int) FftBackend::Pffft })
+            for (int order : { 10, 11, 14 })
+                b->Args({ backend, order });
+    }
+}
+
+static void BM_FftForward(benchmark::State& state)
+{
+    const int order = (int) state.range(1);
+    auto plan = makePlan(state, (FftBackend) state.range(0), order);
+    if (plan == nullptr) return;
+
+    const auto input = makeInput(1 << order);
+    AlignedFloatVector work(input.size());
+    for (auto _ : state)
+    {
+        std::copy(input.begin(), input.begin() + (1 << order), work.begin());
+        plan->forward(work.data());
+        benchmark::DoNotOptimize(work.data());
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_FftForward)->Apply(fftArgs);
+
+// Forward + power spectrum + inverse, as in the FFT autocorrelation
+static void BM_FftAutocorrelation(benchmark::State& state)
+{
+    const int order = (int) state.range(1);
+    const int size = 1 << order;
+    auto plan = makePlan(state, (FftBackend) state.range(0), order);
+    if (plan == nullptr) return;
+
+    const auto input = makeInput(size);
+    AlignedFloatVector work(input.size());
+    for (auto _ : state)
+    {
+        std::copy(input.begin(), input.begin() + size, work.begin());
+        plan->forward(work.data());
+        for (int k = 0; k <= size / 2; ++k)
+        {
+            const float re = work[(size_t) k * 2], im = work[(size_t) k * 2 + 1];
+            work[(size_t) k * 2] = re * re + im * im;
+            work[(size_t) k * 2 + 1] = 0.0f;
+        }
+        plan->inverse(work.data());
+        benchmark::DoNotOptimize(work.data());
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_FftAutocorrelation)->Apply(fftArgs);
@@ -0,0 +1,151 @@
+// Time-domain biquad cost: scalar juce::dsp::IIR::Filter sections, one after another, against
+// BiquadFilterBank running the same sections in one SIMD pass. items_per_second is input
+// samples/s; sample_time is the whole filter's time per input sample and section_time that
+// divided by its sections. BM_BiquadSingleScalar (one scalar section) is the bar: the bank's
+// five-band split should cost less per input sample than it.
+//   master_tempo_bench --benchmark_filter=Biquad
+
+#include <JuceHeader.h>
+#include <benchmark/benchmark.h>
+#include "dsp/BiquadFilterBank.h"
+#include <random>
+
+namespace
+{
+    constexpr double benchSampleRate = 48000.0;
+    constexpr int blockSize = 512;                         // DSP thread chunk
+    constexpr float bandEdges[] { 20.0f, 150.0f, 400.0f, 800.0f, 2000.0f, 6000.0f };
+    constexpr int numBands = 5;
+
+    std::vector<float> makeNoise()
+    {
+        std::vector<float> data((size_t) blockSize);
+        std::mt19937 rng(7u);
+        std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+        for (auto& v : data) v = dist(rng);
+        return data;
+    }
+
+    void setCounters(benchmark::State& state, int sections)
+    {
+        state.SetItemsProcessed(state.iterations() * blockSize);
+        state.counters["sample_time"] = benchmark::Counter((double) state.iterations() * blockSize,
+                                                           benchmark::Counter::kIsRate | benchmark::Counter::kInvert);
+        state.counters["section_time"] = benchmark::Counter((double) state.iterations() * blockSize * sections,
+                                                            benchmark::Counter::kIsRate | benchmark::Counter::kInvert);
+    }
+
+    using ScalarFilter = juce::dsp::IIR::Filter<float>;
+
+    std::unique_ptr<ScalarFilter> makeScalar(bool highPass, float frequency)
+    {
+        auto f = std::make_unique<ScalarFilter>();
+        f->coefficients = highPass ? juce::dsp::IIR::Coefficients<float>::makeHighPass(benchSampleRate, frequency)
+                                   : juce::dsp::IIR::Coefficients<float>::makeLowPass(benchSampleRate, frequency);
+        f->reset();
+        return f;
+    }
+}
+
+// One scalar section: the cost per sample the band split is measured against
+static void BM_BiquadSingleScalar(benchmark::State& state)
+{
+    const auto input = makeNoise();
+    std::vector<float> work(input.size());
+    auto lp = makeScalar(false, 6000.0f);
+    for (auto _ : state)
+    {
+        std::copy(input.begin(), input.end(), work.begin());
+        for (auto& v : work)
+            v = lp->processSample(v);
+        benchmark::DoNotOptimize(work.data());
+    }
+    setCounters(state, 1);
+}
+BENCHMARK(BM_BiquadSingleScalar);
+
+// Prefilter (HP 20 Hz then LP 6 kHz) as two scalar sections
+static void BM_BiquadPrefilterScalar(benchmark::State& state)
+{
+    const auto input = makeNoise();
+    std::vector<float> work(input.size());
+    auto hp = makeScalar(true, 20.0f);
+    auto lp = makeScalar(false, 6000.0f);
+    for (auto _ : state)
+    {
+        std::copy(input.begin(), input.end(), work.begin());
+        for (auto& v : work)
+            v = lp->processSample(hp->processSample(v));
+        benchmark::DoNotOptimize(work.data());
+    }
+    setCounters(state, 2);
+}
+BENCHMARK(BM_BiquadPrefilterScalar);
+
+static void BM_BiquadPrefilterBank(benchmark::State& state)
+{
+    const auto input = makeNoise();
+    std::vector<float> work(input.size());
+    BiquadFilterBank bank(BiquadFilterBank::Topology::Series, 2);
+    bank.setSection(0, BiquadFilterBank::Type::HighPass, 20.0f);
+    bank.setSection(1, BiquadFilterBank::Type::LowPass, 6000.0f);
+    bank.prepare(benchSampleRate);
+    for (auto _ : state)
+    {
+        std::copy(input.begin(), input.end(), work.begin());
+        bank.processSeries(work.data(), blockSize);
+        benchmark::DoNotOptimize(work.data());
+    }
+    setCounters(state, 2);
+}
+BENCHMARK(BM_BiquadPrefilterBank);
+
+// Five-band split, each band HP then LP: one input copy and two scalar sections per band
+static void BM_BiquadBandSplitScalar(benchmark::State& state)
+{
+    const auto input = makeNoise();
+    std::vector<std::vector<float>> bands((size_t) numBands, std::vector<float>(input.size()));
+    std::vector<std::unique_ptr<ScalarFilter>> hp, lp;
+    for (int b = 0; b < numBands; ++b)
+    {
+        hp.push_back(makeScalar(true, bandEdges[b]));
+        lp.push_back(makeScalar(false, bandEdges[b + 1]));
+    }
+    for (auto _ : state)
+    {
+        for (int b = 0; b < numBands; ++b)
+        {
+            auto& band = bands[(size_t) b];
+            std::copy(input.begin(), input.end(), band.begin());
+            for (auto& v : band)
+                v = lp[(size_t) b]->processSample(hp[(size_t) b]->processSample(v));
+            benchmark::DoNotOptimize(band.data());
+        }
+    }
+    setCounters(state, numBands * 2);
+}
+BENCHMARK(BM_BiquadBandSplitScalar);
+
+static void BM_BiquadBandSplitBank(benchmark::State& state)
+{
+    const auto input = makeNoise();
+    std::vector<std::vector<float>> bands((size_t) numBands, std::vector<float>(input.size()));
+    float* outputs[numBands];
+    for (int b = 0; b < numBands; ++b)
+        outputs[b] = bands[(size_t) b].data();
+
+    BiquadFilterBank bank(BiquadFilterBank::Topology::Parallel, numBands, 2);
+    for (int b = 0; b < numBands; ++b)
+    {
+        bank.setSection(b, BiquadFilterBank::Type::HighPass, bandEdges[b], 0.70710678f, 0);
+        bank.setSection(b, BiquadFilterBank::Type::LowPass, bandEdges[b + 1], 0.70710678f, 1);
+    }
+    bank.prepare(benchSampleRate);
+    for (auto _ : state)
+    {
+        bank.processParallel(input.data(), outputs, blockSize);
+        benchmark::DoNotOptimize(outputs[0]);
+    }
+    setCounters(state, numBands * 2);
+}
+BENCHMARK(BM_BiquadBandSplitBank);
@@ -0,0 +1,124 @@
+// The analysis tick's onset fusion (OnsetFusion): weighted z-score fusion of the five bands'
+// flux, and clustering/gating of the bands' onsets, on synthetic detector output for a
+// 120 BPM pattern at the live tick rate (100 Hz, two 240-sample flux hops per tick).
+// items_per_second is ticks/s for the flux fusion and onset batches/s for the gating.
+//   master_tempo_bench --benchmark_filter=Fusion
+
+#include <JuceHeader.h>
+#include <benchmark/benchmark.h>
+#include "dsp/OnsetFusion.h"
+#include <random>
+
+namespace
+{
+    constexpr double tickSec = 0.010;
+    constexpr int fluxFramesPerTick = 2;
+    constexpr int ticksPerCycle = 800;                     // 8 s, a whole number of bars
+    constexpr double cycleSec = ticksPerCycle * tickSec;
+
+    struct Tick
+    {
+        OnsetFusion::BandFlux flux;
+        OnsetFusion::BandOnsets bandOnsets;                // high resolution, sorted
+        std::vector<double> merged;                        // both resolutions
+    };
+
+    // Kicks on the beats reach the two low bands, hats on the off-beats the three high ones;
+    // each band reports them with a few ms of jitter at both resolutions, plus stray onsets
+    std::vector<Tick> makeTicks()
+    {
+        std::vector<Tick> ticks((size_t) ticksPerCycle);
+        std::mt19937 rng(3u);
+        std::uniform_real_distribution<float> noise(0.0f, 0.2f);
+        std::normal_distribution<double> jitter(0.0, 0.003);
+        std::uniform_real_distribution<double> unit(0.0, 1.0);
+        for (int t = 0; t < ticksPerCycle; ++t)
+        {
+            auto& tick = ticks[(size_t) t];
+            const double start = t * tickSec;
+            const int eighth = (int) std::floor(start / 0.25 + 1.0e-9);
+            const bool hasEvent = start - eighth * 0.25 < tickSec;
+            const bool kick = hasEvent && eighth % 2 == 0;
+            for (int b = 0; b < OnsetFusion::numBands; ++b)
+            {
+                const bool hit = hasEvent && (kick ? b < 2 : b >= 2);
+                for (int f = 0; f < fluxFramesPerTick; ++f)
+                    tick.flux[(size_t) b].push_back(noise(rng) + (hit && f == 0 ? 1.0f : 0.0f));
+                if (hit || unit(rng) < 0.005)
+                {
+                    const double onset = start + juce::jlimit(-0.004, 0.004, jitter(rng));
+                    tick.bandOnsets[(size_t) b].push_back(onset);
+                    tick.merged.push_back(onset);
+                    tick.merged.push_back(onset + juce::jlimit(-0.004, 0.004, jitter(rng)));
+                }
+            }
+        }
+        return ticks;
+    }
+
+    // A tick's onsets moved by offset, for the later passes over the cycle
+    void shift(const Tick& tick, double offset, OnsetFusion::BandOnsets& bandOnsets, std::vector<double>& merged)
+    {
+        for (size_t b = 0; b < bandOnsets.size(); ++b)
+        {
+            bandOnsets[b].clear();
+            for (double t : tick.bandOnsets[b])
+                bandOnsets[b].push_back(t + offset);
+        }
+        merged.clear();
+        for (double t : tick.merged)
+            merged.push_back(t + offset);
+    }
+}
+
+static void BM_FusionFlux(benchmark::State& state)
+{
+    const auto ticks = makeTicks();
+    OnsetFusion fusion;
+    std::vector<float> fused;
+    fused.reserve(64);
+    size_t t = 0;
+    for (auto _ : state)
+    {
+        fusion.fuseFlux(ticks[t].flux, fused);
+        benchmark::DoNotOptimize(fused.data());
+        t = (t + 1) % ticks.size();
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_FusionFlux);
+
+// Only the ticks that have onsets: the analysis tick skips gating otherwise. Includes copying
+// the batch in, which the pipeline does while collecting it.
+static void BM_FusionGate(benchmark::State& state)
+{
+    const auto ticks = makeTicks();
+    std::vector<size_t> batches;
+    for (size_t t = 0; t < ticks.size(); ++t)
+        if (!ticks[t].merged.empty())
+            batches.push_back(t);
+
+    OnsetFusion fusion;
+    OnsetFusion::BandOnsets bandOnsets;
+    std::vector<double> merged;
+    for (auto& b : bandOnsets)
+        b.reserve(16);
+    merged.reserve(64);
+    size_t i = 0;
+    double offset = 0.0;
+    int survivors = 0;
+    for (auto _ : state)
+    {
+        shift(ticks[batches[i]], offset, bandOnsets, merged);
+        fusion.gateOnsets(bandOnsets, merged, 120.0);
+        survivors += (int) merged.size();
+        if (++i == batches.size())
+        {
+            i = 0;
+            offset += cycleSec;
+        }
+    }
+    state.counters["onsets_per_batch"] = (double) survivors / (double) juce::jmax<int64_t>(1, state.iterations());
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_FusionGate);
@@ -0,0 +1,148 @@
+// Onset detection cost at the pipeline's two resolutions (48 kHz: 1024-point FFT with a 240
+// hop, 2048-point with a 480 hop) on a synthetic kick/hat pattern at 120 BPM over noise.
+// items_per_second is input samples/s, or spectrum frames/s for the per-frame benchmarks.
+//   master_tempo_bench --benchmark_filter=Onset
+
+#include <JuceHeader.h>
+#include <benchmark/benchmark.h>
+#include "dsp/OnsetDetector.h"
+#include "dsp/StftFrontEnd.h"
+#include <array>
+#include <memory>
+#include <random>
+
+namespace
+{
+    constexpr double benchSampleRate = 48000.0;
+    constexpr int blockSize = 512;                         // DSP thread chunk
+    constexpr int numBands = 5;
+    constexpr float bandEdges[numBands + 1] { 20.0f, 150.0f, 400.0f, 800.0f, 2000.0f, 6000.0f };
+    constexpr int signalSeconds = 8;
+
+    constexpr int hopForFftSize(int fftSize) { return fftSize == 1024 ? 240 : 480; }
+
+    // Decaying 55 Hz kick on every beat and a noise hat on the off-beats, over quiet noise
+    std::vector<float> makeBeatSignal()
+    {
+        const int length = signalSeconds * (int) benchSampleRate;
+        const int beat = (int) (0.5 * benchSampleRate);
+        std::vector<float> data((size_t) length);
+        std::mt19937 rng(11u);
+        std::uniform_real_distribution<float> noise(-1.0f, 1.0f);
+        for (int i = 0; i < length; ++i)
+        {
+            const int sinceBeat = i % beat;
+            const int sinceHat = (i + beat / 2) % beat;
+            const double tKick = sinceBeat / benchSampleRate;
+            const double tHat = sinceHat / benchSampleRate;
+            float v = 0.02f * noise(rng);
+            v += (float) (0.8 * std::exp(-tKick * 25.0) * std::sin(juce::MathConstants<double>::twoPi * 55.0 * tKick));
+            v += (float) (0.3 * std::exp(-tHat * 120.0)) * noise(rng);
+            data[(size_t) i] = v;
+        }
+        return data;
+    }
+
+    std::array<std::unique_ptr<OnsetDetector>, numBands> makeBandDetectors(int fftSize)
+    {
+        std::array<std::unique_ptr<OnsetDetector>, numBands> detectors;
+        for (int b = 0; b < numBands; ++b)
+        {
+            detectors[(size_t) b] = std::make_unique<OnsetDetector>((int) benchSampleRate, fftSize, hopForFftSize(fftSize),
+                                                                    bandEdges[b], bandEdges[b + 1]);
+            detectors[(size_t) b]->setThresholdWindowSeconds(0.75);
+        }
+        return detectors;
+    }
+
+    // The analysis thread's share: keeps the detectors' queues from overflowing
+    void drain(OnsetDetector& detector, std::vector<float>& flux, std::vector<double>& onsets)
+    {
+        flux.clear();
+        onsets.clear();
+        detector.fetchNewFlux(flux);
+        detector.fetchOnsets(onsets);
+    }
+}
+
+// Standalone detector with its private STFT, the whole band, one block at a time
+template <int FftSize>
+static void BM_OnsetDetectorPushAudio(benchmark::State& state)
+{
+    const auto signal = makeBeatSignal();
+    OnsetDetector detector((int) benchSampleRate, FftSize, hopForFftSize(FftSize));
+    detector.setThresholdWindowSeconds(0.75);
+    std::vector<float> flux;
+    std::vector<double> onsets;
+    size_t pos = 0;
+    for (auto _ : state)
+    {
+        detector.pushAudio(signal.data() + pos, blockSize);
+        drain(detector, flux, onsets);
+        pos = pos + 2 * blockSize <= signal.size() ? pos + blockSize : 0;
+    }
+    state.SetItemsProcessed(state.iterations() * blockSize);
+}
+BENCHMARK_TEMPLATE(BM_OnsetDetectorPushAudio, 1024);
+BENCHMARK_TEMPLATE(BM_OnsetDetectorPushAudio, 2048);
+
+// The five band detectors' per-frame work (flux, adaptive threshold, peak picking) on
+// precomputed spectra: the part of a chunk that runs once per band
+template <int FftSize>
+static void BM_OnsetBandsComputeFrame(benchmark::State& state)
+{
+    const auto signal = makeBeatSignal();
+    FixedStftFrontEnd<FftSize> stft(hopForFftSize(FftSize));
+    SpectrumFrameBuffer frames;
+    frames.prepare(FftSize, (int) signal.size() / hopForFftSize(FftSize) + 1);
+    stft.pushAudio(signal.data(), (int) signal.size(), [&frames](const SpectrumFrame& frame) { frames.push(frame); });
+
+    auto detectors = makeBandDetectors(FftSize);
+    std::vector<float> flux;
+    std::vector<double> onsets;
+    uint64_t frameIndex = 0;
+    for (auto _ : state)
+    {
+        // Stream time keeps running when the signal repeats
+        auto frame = frames[(int) (frameIndex % (uint64_t) frames.size())];
+        frame.frameIndex = frameIndex++;
+        for (auto& detector : detectors)
+            detector->processSpectrum(frame);
+        if (frameIndex % 64 == 0)
+            for (auto& detector : detectors)
+                drain(*detector, flux, onsets);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK_TEMPLATE(BM_OnsetBandsComputeFrame, 1024);
+BENCHMARK_TEMPLATE(BM_OnsetBandsComputeFrame, 2048);
+
+// One resolution of AnalysisPipeline::processChunk on one thread: the shared STFT, then every
+// band detector over the chunk's frames
+template <int FftSize>
+static void BM_OnsetBandsChunk(benchmark::State& state)
+{
+    const auto signal = makeBeatSignal();
+    FixedStftFrontEnd<FftSize> stft(hopForFftSize(FftSize));
+    SpectrumFrameBuffer frames;
+    frames.prepare(FftSize, blockSize / hopForFftSize(FftSize) + 1);
+    auto detectors = makeBandDetectors(FftSize);
+    std::vector<float> flux;
+    std::vector<double> onsets;
+    size_t pos = 0;
+    for (auto _ : state)
+    {
+        frames.clear();
+        stft.pushAudio(signal.data() + pos, blockSize, [&frames](const SpectrumFrame& frame) { frames.push(frame); });
+        for (auto& detector : detectors)
+        {
+            for (int i = 0; i < frames.size(); ++i)
+                detector->processSpectrum(frames[i]);
+            drain(*detector, flux, onsets);
+        }
+        pos = pos + 2 * blockSize <= signal.size() ? pos + blockSize : 0;
+    }
+    state.SetItemsProcessed(state.iterations() * blockSize);
+}
+BENCHMARK_TEMPLATE(BM_OnsetBandsChunk, 1024);
+BENCHMARK_TEMPLATE(BM_OnsetBandsChunk, 2048);
@@ -0,0 +1,279 @@
+// Tempo engine benchmarks: per-frame CPU cost (mean and worst frame) and tempo accuracy of
+// the autocorrelation and comb-filter engines on a synthetic click-track flux at the
+// pipeline's frame rate (240-sample hop at 48 kHz, an estimate every 7 frames); the comb
+// bank alone per frame; addFlux and estimate cost at fixed 600/2048/8192-frame windows; IOI
+// scoring at 64 and 256 onsets.
+//   master_tempo_bench --benchmark_filter=Tempo
+
+#include <JuceHeader.h>
+#include <benchmark/benchmark.h>
+#include "dsp/CombFilterBank.h"
+#include "dsp/TempoEstimator.h"
+#include <chrono>
+#include <memory>
+#include <random>
+
+namespace
+{
+    constexpr double benchSampleRate = 48000.0;
+    constexpr int benchHop = 240;                          // the pipeline's 5 ms hop: 200 flux frames per second
+    constexpr int framesPerUpdate = 7;                     // ~33 ms estimate cadence, as AnalysisPipeline sets it
+    constexpr int warmUpFrames = 20 * 200;                 // 20 s of audio before timing
+
+    // Unit flux pulse on every beat (rounded to whole frames) over uniform noise
+    class ClickTrackFlux {
+    public:
+        ClickTrackFlux(double bpm, unsigned seed)
+            : periodFrames(60.0 * benchSampleRate / (double) benchHop / bpm), rng(seed) {}
+
+        // Next frame; appends the onset time to onsets when the frame carries a beat
+        float next(std::vector<double>& onsets)
+        {
+            float v = noise(rng);
+            if ((double) frame >= nextBeat)
+            {
+                v += 1.0f;
+                nextBeat += periodFrames;
+                onsets.push_back((double) frame * (double) benchHop / benchSampleRate);
+            }
+            ++frame;
+            return v;
+        }
+
+    private:
+        double periodFrames;
+        double nextBeat { 0.0 };
+        long frame { 0 };
+        std::mt19937 rng;
+        std::uniform_real_distribution<float> noise { 0.0f, 0.3f };
+    };
+
+    void feedFrame(TempoEstimator& estimator, ClickTrackFlux& source, std::vector<double>& onsets, long frame)
+    {
+        onsets.clear();
+        const float v = source.next(onsets);
+        if (!onsets.empty())
+            estimator.ingestOnsets(onsets);
+        estimator.addFlux(&v, 1);
+        if (frame % framesPerUpdate == 0)
+            estimator.update();
+    }
+
+    void runTempoEngine(benchmark::State& state, TempoEstimator::Engine engine, TempoEstimator::AcfMode acfMode)
+    {
+        const double truthBpm = (double) state.range(0);
+        TempoEstimator estimator(benchSampleRate, benchHop);
+        estimator.setEngine(engine);
+        estimator.setAcfMode(acfMode);
+        ClickTrackFlux source(truthBpm, 1234u);
+        std::vector<double> onsets;
+        onsets.reserve(4);
+
+        long frame = 0;
+        for (; frame < warmUpFrames; ++frame)
+            feedFrame(estimator, source, onsets, frame);
+
+        // Whole-frame cost including the amortised estimate; the worst frame shows spikes
+        const double ticksToUs = 1.0e6 / (double) juce::Time::getHighResolutionTicksPerSecond();
+        double worstUs = 0.0;
+        for (auto _ : state)
+        {
+            const auto t0 = juce::Time::getHighResolutionTicks();
+            feedFrame(estimator, source, onsets, frame++);
+            worstUs = juce::jmax(worstUs, (double) (juce::Time::getHighResolutionTicks() - t0) * ticksToUs);
+        }
+
+        const double bpm = estimator.getBpm();
+        const double errorPct = bpm > 0.0 ? 100.0 * std::abs(bpm - truthBpm) / truthBpm : 100.0;
+        state.counters["bpm"] = bpm;
+        state.counters["bpm_error_pct"] = errorPct;
+        state.counters["correct"] = errorPct <= 4.0 ? 1.0 : 0.0;
+        state.counters["worst_frame_us"] = worstUs;
+        state.SetItemsProcessed(state.iterations());
+    }
+
+    void tempoArgs(benchmark::internal::Benchmark* b)
+    {
+        for (int bpm : { 72, 90, 105, 120, 128, 140, 160, 174 })
+            b->Arg(bpm);
+        b->Iterations(12000); // 60 s of flux per run, so every engine sees the same signal
+    }
+}
+
+static void BM_TempoAcfStreaming(benchmark::State& state)
+{
+    runTempoEngine(state, TempoEstimator::Engine::Autocorrelation, TempoEstimator::AcfMode::Streaming);
+}
+BENCHMARK(BM_TempoAcfStreaming)->Apply(tempoArgs);
+
+static void BM_TempoAcfFft(benchmark::State& state)
+{
+    runTempoEngine(state, TempoEstimator::Engine::Autocorrelation, TempoEstimator::AcfMode::Fft);
+}
+BENCHMARK(BM_TempoAcfFft)->Apply(tempoArgs);
+
+static void BM_TempoCombFilterBank(benchmark::State& state)
+{
+    runTempoEngine(state, TempoEstimator::Engine::CombFilterBank, TempoEstimator::AcfMode::Streaming);
+}
+BENCHMARK(BM_TempoCombFilterBank)->Apply(tempoArgs);
+
+// The comb bank alone: one flux frame per iteration, lag scores read at the estimate cadence
+// (lags 50-300, 40-240 BPM at 200 frames per second: 251 filters)
+static void BM_TempoCombBankFrame(benchmark::State& state)
+{
+    const double framesPerSecond = benchSampleRate / (double) benchHop;
+    CombFilterBank bank;
+    bank.prepare((int) std::floor(framesPerSecond * 60.0 / 240.0), (int) std::ceil(framesPerSecond * 60.0 / 40.0), framesPerSecond);
+    std::vector<float> scores(512);
+    ClickTrackFlux source(120.0, 7u);
+    std::vector<double> onsets;
+    onsets.reserve(4);
+    long frame = 0;
+    for (auto _ : state)
+    {
+        onsets.clear();
+        bank.process(source.next(onsets));
+        if (++frame % framesPerUpdate == 0)
+            benchmark::DoNotOptimize(bank.getLagScores(scores.data()));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_TempoCombBankFrame);
+
+namespace
+{
+    enum class WindowEngine { AcfStreaming, AcfFft, Comb };
+
+    void windowArgs(benchmark::internal::Benchmark* b)
+    {
+        b->ArgNames({ "engine", "memory" });
+        for (auto engine : { WindowEngine::AcfStreaming, WindowEngine::AcfFft, WindowEngine::Comb })
+            for (int memory : { 600, 2048, 8192 }) // 600: the shortest window, 2 * maxLag at this hop
+                b->Args({ (int) engine, memory });
+    }
+
+    // Estimator with a fixed flux window of state.range(1) frames (adaptive memory off, so the
+    // window does not follow the tempo), filled with a 120 BPM click track. Skips the benchmark
+    // if the filled window has no estimate yet, or it would time the early return
+    std::unique_ptr<TempoEstimator> makeFilledEstimator(benchmark::State& state, ClickTrackFlux& source, long& frame)
+    {
+        const auto engine = (WindowEngine) state.range(0);
+        auto estimator = std::make_unique<TempoEstimator>(benchSampleRate, benchHop);
+        estimator->setEngine(engine == WindowEngine::Comb ? TempoEstimator::Engine::CombFilterBank
+                                                          : TempoEstimator::Engine::Autocorrelation);
+        estimator->setAcfMode(engine == WindowEngine::AcfFft ? TempoEstimator::AcfMode::Fft
+                                                             : TempoEstimator::AcfMode::Streaming);
+        estimator->setAdaptiveMemory(false);
+        estimator->setMemoryFrames((size_t) state.range(1));
+        state.SetLabel(engine == WindowEngine::Comb ? "comb" : engine == WindowEngine::AcfFft ? "acf-fft" : "acf-streaming");
+
+        std::vector<double> onsets;
+        onsets.reserve(4);
+        for (const long end = frame + state.range(1) + warmUpFrames; frame < end; ++frame)
+            feedFrame(*estimator, source, onsets, frame);
+        if (estimator->getBpm() <= 0.0)
+            state.SkipWithError("no tempo estimate from the filled window");
+        return estimator;
+    }
+}
+
+// addFlux for one frame with the window full: the oldest frame leaves, the new one enters
+static void BM_TempoAddFlux(benchmark::State& state)
+{
+    ClickTrackFlux source(120.0, 99u);
+    long frame = 0;
+    auto estimator = makeFilledEstimator(state, source, frame);
+    std::vector<double> onsets;
+    onsets.reserve(4);
+    for (auto _ : state)
+    {
+        onsets.clear();
+        const float v = source.next(onsets);
+        estimator->addFlux(&v, 1);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_TempoAddFlux)->Apply(windowArgs);
+
+// One estimate (update) over the full window; the flux between estimates is not timed
+static void BM_TempoEstimate(benchmark::State& state)
+{
+    ClickTrackFlux source(120.0, 99u);
+    long frame = 0;
+    auto estimator = makeFilledEstimator(state, source, frame);
+    std::vector<double> onsets;
+    onsets.reserve(4);
+    for (auto _ : state)
+    {
+        for (int i = 0; i < framesPerUpdate; ++i)
+        {
+            onsets.clear();
+            const float v = source.next(onsets);
+            if (!onsets.empty())
+                estimator->ingestOnsets(onsets);
+            estimator->addFlux(&v, 1);
+        }
+        const auto t0 = std::chrono::high_resolution_clock::now();
+        estimator->update();
+        state.SetIterationTime(std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - t0).count());
+    }
+    state.counters["bpm"] = estimator->getBpm();
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_TempoEstimate)->Apply(windowArgs)->UseManualTime();
+
+namespace
+{
+    // Eighth notes at 120 BPM with 4 ms jitter, as many as the onset window holds
+    std::unique_ptr<TempoEstimator> makeOnsetWindow(int numOnsets, double& lastOnset)
+    {
+        auto estimator = std::make_unique<TempoEstimator>(benchSampleRate, benchHop);
+        estimator->setMaxRecentOnsets((size_t) numOnsets);
+        std::mt19937 rng(21u);
+        std::normal_distribution<double> jitter(0.0, 0.004);
+        std::vector<double> onsets;
+        for (int i = 0; i < numOnsets; ++i)
+            onsets.push_back(0.25 * (double) i + jitter(rng));
+        estimator->ingestOnsets(onsets);
+        lastOnset = onsets.back();
+        return estimator;
+    }
+
+    void onsetWindowArgs(benchmark::internal::Benchmark* b)
+    {
+        b->ArgName("onsets")->Arg(64)->Arg(256);
+    }
+}
+
+// IOI support of one candidate, sweeping 40-240 BPM as candidate scoring does
+static void BM_TempoIoiSupport(benchmark::State& state)
+{
+    double lastOnset = 0.0;
+    auto estimator = makeOnsetWindow((int) state.range(0), lastOnset);
+    double bpm = 40.0, support = 0.0;
+    for (auto _ : state)
+    {
+        support += estimator->ioiSupportForBpm(bpm);
+        bpm = bpm >= 240.0 ? 40.0 : bpm + 0.5;
+    }
+    benchmark::DoNotOptimize(support);
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_TempoIoiSupport)->Apply(onsetWindowArgs);
+
+// One new onset into a full window: its intervals enter the histogram, the oldest onset's leave
+static void BM_TempoIngestOnset(benchmark::State& state)
+{
+    double lastOnset = 0.0;
+    auto estimator = makeOnsetWindow((int) state.range(0), lastOnset);
+    std::vector<double> onset(1);
+    for (auto _ : state)
+    {
+        lastOnset += 0.25;
+        onset[0] = lastOnset;
+        estimator->ingestOnsets(onset);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_TempoIngestOnset)->Apply(onsetWindowArgs);
@@ -1,5 +1,8 @@
 #include <JuceHeader.h>
 #include "MainComponent.h"
+#include "dsp/FftPlanPool.h"
+#include "dsp/AllocationCounter.h"
+#include <fstream>
 
 class MasterTempoApplication  : public juce::JUCEApplication
 {
@@ -8,13 +11,80 @@ public:
     const juce::String getApplicationVersion() override    { return "0.1.0"; }
     bool moreThanOneInstanceAllowed() override             { return true; }
 
-    void initialise (const juce::String&) override
+    void initialise (const juce::String& commandLine) override
     {
+        // --fft=juce / --fft=pffft overrides the build's default FFT backend
+        if (commandLine.contains ("--fft=juce"))
+            FftPlanPool::getInstance().setDefaultBackend (FftBackend::Juce);
+        else if (commandLine.contains ("--fft=pffft") && isFftBackendAvailable (FftBackend::Pffft))
+            FftPlanPool::getInstance().setDefaultBackend (FftBackend::Pffft);
+
+        // Builds with MASTER_TEMPO_RT_SAFETY_CHECKS report violations by default
+        if (commandLine.contains ("--rt-check=abort"))
+            RealtimeSafety::setMode (RealtimeSafety::Mode::Abort);
+        else if (commandLine.contains ("--rt-check=off"))
+            RealtimeSafety::setMode (RealtimeSafety::Mode::Off);
+
+        // --profile-csv=file writes every stream's per-stage timing on exit
+        if (commandLine.contains ("--profile-csv="))
+            profileCsvPath = commandLine.fromFirstOccurrenceOf ("--profile-csv=", false, false).upToFirstOccurrenceOf (" ", false, false).unquoted();
+
         mainWindow.reset (new MainWindow (getApplicationName()));
+
+        // --stream=<endpoint>:<prefix> (repeatable) analyses a further loopback endpoint whose
+        // OSC addresses get the prefix, e.g. --stream="Speakers 2:/deck2"
+        if (auto* main = dynamic_cast<MainComponent*> (mainWindow->getContentComponent()))
+            for (const auto& token : juce::StringArray::fromTokens (commandLine, true))
+            {
+                if (! token.startsWith ("--stream="))
+                    continue;
+                const auto spec = token.fromFirstOccurrenceOf ("=", false, false).unquoted();
+                const auto endpoint = spec.upToLastOccurrenceOf (":", false, false);
+                auto prefix = spec.fromLastOccurrenceOf (":", false, false);
+                if (endpoint.isEmpty() || ! spec.contains (":"))
+                {
+                    juce::Logger::writeToLog ("--stream needs <endpoint>:<prefix>, got " + spec);
+                    continue;
+                }
+                if (! prefix.startsWith ("/"))
+                    prefix = "/" + prefix;
+                if (! main->addLoopbackStream (endpoint, prefix))
+                    juce::Logger::writeToLog ("Could not start stream " + prefix + " on " + endpoint);
+            }
+
+        // --analysis-rate=Hz (OSC/MIDI output, default 100) and --ui-rate=Hz (default 30); after
+        // the --stream options so the extra streams get the rate too
+        if (auto* main = dynamic_cast<MainComponent*> (mainWindow->getContentComponent()))
+        {
+            if (commandLine.contains ("--analysis-rate="))
+                main->setAnalysisRateHz (commandLine.fromFirstOccurrenceOf ("--analysis-rate=", false, false).getIntValue());
+            if (commandLine.contains ("--ui-rate="))
+                main->setUiRateHz (commandLine.fromFirstOccurrenceOf ("--ui-rate=", false, false).getIntValue());
+
+            // Primary stream's capture FIFO: --fifo-policy=block|drop-oldest, and
+            // --fifo-capacity=<samples> for a fixed capacity instead of auto-grow
+            if (commandLine.contains ("--fifo-policy=block"))
+                main->setCaptureFifoPolicy (CaptureFifo::Policy::BlockBriefly);
+            else if (commandLine.contains ("--fifo-policy=drop-oldest"))
+                main->setCaptureFifoPolicy (CaptureFifo::Policy::DropOldest);
+            if (commandLine.contains ("--fifo-capacity="))
+                main->setCaptureFifoCapacity (commandLine.fromFirstOccurrenceOf ("--fifo-capacity=", false, false).getIntValue(), false);
+
+            // --osc-legacy-beat also sends onsets as the deprecated /beat t
+            if (commandLine.contains ("--osc-legacy-beat"))
+                main->setSendLegacyBeatOnsets (true);
+        }
     }
 
     void shutdown() override
     {
+        if (profileCsvPath.isNotEmpty() && mainWindow != nullptr)
+            if (auto* main = dynamic_cast<MainComponent*> (mainWindow->getContentComponent()))
+            {
+                std::ofstream csv (profileCsvPath.toStdString());
+                StageProfiler::writeCsvHeader (csv);
+                main->writeStageProfileCsv (csv);
+            }
         mainWindow = nullptr;
     }
 
@@ -49,6 +119,7 @@ public:
 
 private:
     std::unique_ptr<MainWindow> mainWindow;
+    juce::String profileCsvPath;
 };
 
 START_JUCE_APPLICATION (MasterTempoApplication)
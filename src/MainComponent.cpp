@@ -3,6 +3,8 @@
 
 MainComponent::MainComponent()
 {
+	streams.reserve ((size_t) maxStreams);
+	streams.push_back (std::make_unique<AnalysisPipeline> (detectorPool));
 	setAudioChannels (0, 0);
    #if JUCE_WINDOWS
 	startLoopbackCaptureForEndpoint (preferredOutputName);
@@ -18,9 +20,15 @@ MainComponent::MainComponent()
 
 MainComponent::~MainComponent()
 {
+	stopTimer();
 	deviceManager.removeAudioCallback (this);
 	shutdownAudio();
-	stopDspThread();
+   #if JUCE_WINDOWS
+	loopbackCapture.reset();
+	extraLoopbackCaptures.clear();
+   #endif
+	for (auto& stream : streams)
+		stream->stop();
 }
 
 void MainComponent::prepareToPlay (int samplesPerBlockExpected, double sr)
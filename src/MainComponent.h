@@ -1,13 +1,9 @@
 #pragma once
 
 #include <JuceHeader.h>
-#include "dsp/OnsetDetector.h"
-#include "dsp/TempoEstimator.h"
-#include "dsp/BeatTracker.h"
-#include <array>
- #include <deque>
-#include <thread>
-#include <mutex>
+#include "core/AnalysisPipeline.h"
+#include <memory>
+#include <vector>
 #if JUCE_WINDOWS
 #include "win/WASAPILoopback.h"
 #endif
@@ -37,6 +33,36 @@ public:
     void paint (juce::Graphics& g) override;
     void resized() override;
 
+    // Capture FIFO accounting and tuning of the primary stream; callable from any thread
+    CaptureFifo::Stats getCaptureStats() const { return streams.front()->getCaptureFifo().getStats(); }
+    void setCaptureFifoPolicy (CaptureFifo::Policy policy) { streams.front()->getCaptureFifo().setPolicy (policy); }
+    void setCaptureFifoCapacity (int samples, bool autoGrow)
+    {
+        streams.front()->getCaptureFifo().setCapacity (samples);
+        streams.front()->getCaptureFifo().setAutoGrow (autoGrow);
+    }
+
+    // Deprecated /beat t onset messages on every stream (see AnalysisPipeline::setSendLegacyBeatOnsets)
+    void setSendLegacyBeatOnsets (bool shouldSend)
+    {
+        for (auto& stream : streams)
+            stream->setSendLegacyBeatOnsets (shouldSend);
+    }
+
+    // Per-stage timing of every stream (StageProfiler CSV rows, source = OSC prefix)
+    void writeStageProfileCsv (std::ostream& out) const;
+
+    // Analyses a further loopback endpoint alongside the primary one; its OSC addresses get the
+    // given prefix. Windows only; returns false if capture could not start.
+    bool addLoopbackStream (const juce::String& outputName, const juce::String& oscPrefix);
+    int getNumStreams() const noexcept { return (int) streams.size(); }
+
+    // Analysis runs in the streams' own threads (core/AnalysisPipeline); the UI timer only reads
+    // the primary stream's snapshot. The two rates are independent; the UI drops to
+    // minimisedUiRateHz while minimised. Set from --analysis-rate= / --ui-rate= (Main.cpp).
+    void setAnalysisRateHz (int hz);
+    void setUiRateHz (int hz);
+
 private:
     void timerCallback() override;
 
@@ -78,76 +104,36 @@ private:
     juce::ComboBox midiOutBox;
     juce::TextButton refreshMidiButton { "Refresh MIDI" };
     juce::TextButton connectMidiButton { "Connect MIDI" };
+    std::unique_ptr<juce::MidiOutput> midiOut; // sent to by streams[0] through its MIDI sender
 
     // Audio processing state
     std::atomic<double> currentSampleRate { 0.0 };
     std::atomic<int> blockSize { 0 };
 
-    // Ring buffer for callback->DSP handoff (mono)
-    juce::AbstractFifo fifo { 1 << 14 }; // 16384 samples
-    juce::AudioBuffer<float> ringBuffer { 1, 1 << 14 };
-
-    // Band limiting: 100 Hz HPF -> 4 kHz LPF
-    juce::dsp::ProcessorChain<juce::dsp::IIR::Filter<float>, juce::dsp::IIR::Filter<float>> bandFilter;
-    juce::dsp::ProcessSpec dspSpec {};
-
-    // Debug: counters
-    std::atomic<uint64_t> totalBlocks { 0 };
-
-    // Multiresolution multiband onset detection: 20-150, 150-400, 400-800, 800-2000, 2000-6000 Hz
-    // High- and low-resolution detectors per band
-    std::array<std::unique_ptr<OnsetDetector>, 5> bandOnsetsHi;
-    std::array<std::unique_ptr<OnsetDetector>, 5> bandOnsetsLo;
-    // Per-band bandpass filters (HPF + LPF per band) used to feed detectors with band-limited audio
-    std::array<juce::dsp::ProcessorChain<juce::dsp::IIR::Filter<float>, juce::dsp::IIR::Filter<float>>, 5> perBandFilters;
-    std::unique_ptr<TempoEstimator> tempoEstimator;
-    std::unique_ptr<BeatTracker> beatTracker;
-    std::atomic<uint64_t> capturedSamples { 0 };
-    std::array<std::deque<double>, 5> recentBandOnsets;
-    double bandOnsetWindowSec { 4.0 };
-    std::mutex bandMutex; // guards access to bandOnsets during capture/timer/prepare
-
-    // Pending flux buffers (high-resolution) to align frames across bands before combining
-    std::array<std::vector<float>, 5> pendingFluxHi;
-
-    // EWMA normalization state for per-band flux fusion
-    std::array<float, 5> fusionEwmaMean { 0,0,0,0,0 };
-    std::array<float, 5> fusionEwmaVar  { 0,0,0,0,0 };
-    std::array<bool, 5>  fusionEwmaInit { false,false,false,false,false };
-
-    // OSC streaming
-    juce::OSCSender osc;
-    bool oscConnected { false };
-    std::array<float, 5> bandActivity { 0,0,0,0,0 };
-
-    // MIDI streaming
-    std::unique_ptr<juce::MidiOutput> midiOut;
-    int midiCcForTempo { 20 }; // default CC number for tempo
-    int midiChannel { 1 };
-    int midiBeatNote { 60 }; // C4 for beat pulses
+    // Analysed streams; streams[0] is the one the UI controls and shows, with plain OSC
+    // addresses. All of them share detectorPool and the FFT plans.
+    // The vector is reserved for maxStreams up front: capture threads read streams[0] while
+    // the message thread adds streams.
+    static constexpr int maxStreams = 16;
+    WorkStealingPool detectorPool;
+    std::vector<std::unique_ptr<AnalysisPipeline>> streams;
+    AnalysisPipeline& primaryStream() noexcept { return *streams.front(); }
 
     bool usingLoopback { false };
     juce::String preferredOutputName { "Głośniki" }; // target output device friendly name (e.g., Speakers/Głośniki)
-    bool sendTempoCandidates { false };
-    double minConfidenceForUpdates { 0.2 };
-    // Onset merge and coincidence gating params
-    double coincidenceWindowSec { 0.015 }; // small fixed window for multi-band coincidence
-    int minBandsForOnset { 2 };
-
-    // DSP worker thread to decouple capture and processing
-    std::thread dspThread;
-    std::atomic<bool> dspRunning { false };
-    void startDspThread();
-    void stopDspThread();
 
-    // Wall-clock mapping from WASAPI QPC to sample time
-    std::atomic<double> lastQpcSeconds { 0.0 };
+    std::atomic<int> uiRateHz { 30 };
+    static constexpr int minimisedUiRateHz = 2;
+    uint64_t lastUiSnapshotVersion { 0 };
+    AnalysisPipeline::Snapshot uiSnapshot;  // last snapshot shown; paint draws its beat phase and bands
+    juce::Rectangle<int> activityArea;      // set by resized()
 
     void refreshLoopbackList();
     bool selectLoopbackByOutputName (const juce::String& nameKeyword);
 
 #if JUCE_WINDOWS
     std::unique_ptr<WASAPILoopbackCapture> loopbackCapture;
+    std::vector<std::unique_ptr<WASAPILoopbackCapture>> extraLoopbackCaptures; // streams[1..]
 #endif
 
     void prepareProcessing (double sr, int samplesPerBlockExpected);
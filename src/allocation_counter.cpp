@@ -0,0 +1,90 @@
+#include "dsp/AllocationCounter.h"
+
+#if MASTER_TEMPO_COUNT_ALLOCATIONS
+#include <algorithm>
+#include <cstdlib>
+#include <new>
+#if defined (_WIN32)
+ #include <malloc.h>
+#endif
+
+// Replacement global allocation functions: count (and flag real-time violations), then defer
+// to malloc/free. The array, nothrow and sized forms all route through these two, and the
+// std::align_val_t forms (over-aligned types such as SIMD lanes) through alignedAllocate.
+static void noteAllocation() noexcept
+{
+    ++AllocationCounter::threadAllocations;
+    if (RealtimeSafety::isRealtimeThread())
+        RealtimeSafety::reportViolation (RealtimeSafety::Violation::Allocation);
+}
+
+void* operator new (std::size_t size)
+{
+    noteAllocation();
+    if (void* p = std::malloc(size == 0 ? 1 : size))
+        return p;
+    throw std::bad_alloc();
+}
+
+// Memory from these must go back through alignedFree: _aligned_malloc blocks cannot be passed
+// to free on Windows
+static void* alignedAllocate (std::size_t size, std::align_val_t alignment) noexcept
+{
+    noteAllocation();
+    const auto align = std::max ((std::size_t) alignment, sizeof (void*));
+   #if defined (_WIN32)
+    return _aligned_malloc (size == 0 ? 1 : size, align);
+   #else
+    void* p = nullptr;
+    return posix_memalign (&p, align, size == 0 ? 1 : size) == 0 ? p : nullptr;
+   #endif
+}
+
+static void alignedFree (void* p) noexcept
+{
+   #if defined (_WIN32)
+    _aligned_free (p);
+   #else
+    std::free (p);
+   #endif
+}
+
+void* operator new[] (std::size_t size)                              { return operator new (size); }
+void* operator new (std::size_t size, const std::nothrow_t&) noexcept
+{
+    noteAllocation();
+    return std::malloc(size == 0 ? 1 : size);
+}
+void* operator new[] (std::size_t size, const std::nothrow_t& tag) noexcept { return operator new (size, tag); }
+
+void operator delete (void* p) noexcept                              { std::free(p); }
+void operator delete[] (void* p) noexcept                            { std::free(p); }
+void operator delete (void* p, std::size_t) noexcept                 { std::free(p); }
+void operator delete[] (void* p, std::size_t) noexcept               { std::free(p); }
+void operator delete (void* p, const std::nothrow_t&) noexcept       { std::free(p); }
+void operator delete[] (void* p, const std::nothrow_t&) noexcept     { std::free(p); }
+
+void* operator new (std::size_t size, std::align_val_t alignment)
+{
+    if (void* p = alignedAllocate (size, alignment))
+        return p;
+    throw std::bad_alloc();
+}
+
+void* operator new[] (std::size_t size, std::align_val_t alignment)  { return operator new (size, alignment); }
+void* operator new (std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+    return alignedAllocate (size, alignment);
+}
+void* operator new[] (std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+    return alignedAllocate (size, alignment);
+}
+
+void operator delete (void* p, std::align_val_t) noexcept                                 { alignedFree (p); }
+void operator delete[] (void* p, std::align_val_t) noexcept                               { alignedFree (p); }
+void operator delete (void* p, std::size_t, std::align_val_t) noexcept                    { alignedFree (p); }
+void operator delete[] (void* p, std::size_t, std::align_val_t) noexcept                  { alignedFree (p); }
+void operator delete (void* p, std::align_val_t, const std::nothrow_t&) noexcept          { alignedFree (p); }
+void operator delete[] (void* p, std::align_val_t, const std::nothrow_t&) noexcept        { alignedFree (p); }
+#endif
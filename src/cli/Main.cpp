@@ -0,0 +1,233 @@
+// master_tempo_cli: analyses audio files with the headless core as fast as the CPU allows
+//
+//   master_tempo_cli [options] file...
+//     --tempo         print each tempo estimate:  tempo <time_s> <bpm> <confidence>
+//     --beats         print the beat grid:        beat <time_s>
+//     --onsets        print gated onsets:         onset <time_s>
+//     --chunked       analyse chunks of the file in parallel and stitch them (long recordings)
+//     --verify-chunked  analyse sequentially and chunked, compare; exit code 1 on a mismatch
+//     --threads=N     threads for the chunked modes (default: one per core)
+//     --chunk=SECONDS longest chunk for the chunked modes
+//     --fft=juce|pffft
+//     --profile-csv=FILE  write per-stage latency histograms of each (sequential) analysis
+//     --load-test[=seconds per step]   run the real-time stream load test instead
+//     --accuracy[=seconds per signal]  run the synthetic-signal accuracy test instead; exit
+//                     code 1 if any signal breaks its accuracy limits
+//     --chunked-test[=seconds per signal]  check chunked against sequential analysis on the
+//                     synthetic signals and measure the speed-up per thread count; exit code 1
+//                     on a mismatch
+//
+// Each file ends with a summary line (final BPM, confidence, duration, processing time and
+// the x real-time factor); several files end with a total.
+
+#include <JuceHeader.h>
+#include "core/OfflineAnalysis.h"
+#include "tools/LoadTest.h"
+#include "tools/AccuracyTest.h"
+#include "tools/ChunkedTest.h"
+#include "dsp/FftPlanPool.h"
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+
+namespace
+{
+    struct Options
+    {
+        bool printTempo { false };
+        bool printBeats { false };
+        bool printOnsets { false };
+        bool chunked { false };
+        bool verifyChunked { false };
+        ChunkedAnalysisOptions chunking;
+        juce::String profileCsvPath;
+        juce::StringArray files;
+    };
+
+    // Chunked output must match a sequential pass this closely
+    constexpr double verifyTimeToleranceSec = 0.005;
+    constexpr double verifyBpmTolerance = 0.5;
+    constexpr double verifyMinMatched = 0.99;
+
+    void printUsage()
+    {
+        std::cerr << "usage: master_tempo_cli [--tempo] [--beats] [--onsets] [--chunked | --verify-chunked]\n"
+                     "                        [--threads=N] [--chunk=seconds] [--fft=juce|pffft] [--profile-csv=file] file...\n"
+                     "       master_tempo_cli --load-test[=seconds per step]\n"
+                     "       master_tempo_cli --accuracy[=seconds per signal]\n"
+                     "       master_tempo_cli --chunked-test[=seconds per signal]" << std::endl;
+    }
+
+    void printTimelines (const OfflineAnalysisResult& result, const Options& options)
+    {
+        std::cout << std::fixed;
+        if (options.printTempo)
+            for (const auto& p : result.tempo)
+                std::cout << "tempo " << std::setprecision (3) << p.timeSec << " " << std::setprecision (2) << p.bpm
+                          << " " << std::setprecision (3) << p.confidence << "\n";
+        if (options.printBeats)
+            for (auto t : result.beats)
+                std::cout << "beat " << std::setprecision (3) << t << "\n";
+        if (options.printOnsets)
+            for (auto t : result.onsets)
+                std::cout << "onset " << std::setprecision (3) << t << "\n";
+    }
+
+    // Runs the file both ways and prints how closely the chunked result follows the sequential
+    // one. The sequential pass runs on one core, so the speed-up is against a single chain.
+    bool verifyChunked (const juce::File& file, const juce::String& path, const Options& options)
+    {
+        WorkStealingPool singleCore (0);
+        OfflineAnalysisResult sequential, chunked;
+        juce::String error;
+        if (! analyseFile (file, singleCore, sequential, error) || ! analyseFileChunked (file, options.chunking, chunked, error))
+        {
+            std::cerr << path << ": " << error << std::endl;
+            return false;
+        }
+
+        const auto c = compareResults (sequential, chunked, verifyTimeToleranceSec, verifyBpmTolerance);
+        const double onsets = OfflineComparison::fraction (c.onsetsMatched, c.onsetsCompared);
+        const double beats = OfflineComparison::fraction (c.beatsMatched, c.beatsCompared);
+        const double bpm = OfflineComparison::fraction (c.bpmSamplesMatched, c.bpmSamples);
+        const bool ok = onsets >= verifyMinMatched && beats >= verifyMinMatched && bpm >= verifyMinMatched;
+
+        std::cout << std::fixed << path << ": " << (ok ? "match" : "MISMATCH") << std::setprecision (2)
+                  << ", onsets " << 100.0 * onsets << "% (" << c.onsetsMatched << "/" << c.onsetsCompared
+                  << ", max error " << std::setprecision (1) << 1000.0 * c.maxOnsetErrorSec << " ms)"
+                  << std::setprecision (2) << ", beats " << 100.0 * beats << "% (" << c.beatsMatched << "/" << c.beatsCompared << ")"
+                  << ", bpm " << 100.0 * bpm << "% within " << verifyBpmTolerance << " (max error " << c.maxBpmError << ")"
+                  << ", seams " << chunked.numSeams << " (" << chunked.unmatchedSeams << " unmatched)"
+                  << ", sequential " << sequential.processingSec << " s, chunked " << chunked.processingSec << " s, speed-up "
+                  << (chunked.processingSec > 0.0 ? sequential.processingSec / chunked.processingSec : 0.0) << "x" << std::endl;
+        return ok;
+    }
+}
+
+int main (int argc, char* argv[])
+{
+    Options options;
+    for (int i = 1; i < argc; ++i)
+    {
+        const juce::String arg (argv[i]);
+        if (arg == "--tempo")              options.printTempo = true;
+        else if (arg == "--beats")         options.printBeats = true;
+        else if (arg == "--onsets")        options.printOnsets = true;
+        else if (arg == "--chunked")       options.chunked = true;
+        else if (arg == "--verify-chunked") options.verifyChunked = true;
+        else if (arg.startsWith ("--threads="))
+            options.chunking.numThreads = arg.fromFirstOccurrenceOf ("=", false, false).getIntValue();
+        else if (arg.startsWith ("--chunk="))
+        {
+            options.chunking.chunkSec = arg.fromFirstOccurrenceOf ("=", false, false).getDoubleValue();
+            options.chunking.minChunkSec = juce::jmin (options.chunking.minChunkSec, options.chunking.chunkSec);
+        }
+        else if (arg.startsWith ("--profile-csv="))
+            options.profileCsvPath = arg.fromFirstOccurrenceOf ("=", false, false);
+        else if (arg == "--fft=juce")      FftPlanPool::getInstance().setDefaultBackend (FftBackend::Juce);
+        else if (arg == "--fft=pffft")
+        {
+            if (! isFftBackendAvailable (FftBackend::Pffft))
+            {
+                std::cerr << "pffft backend not built (configure with -DMASTER_TEMPO_WITH_PFFFT=ON)" << std::endl;
+                return 2;
+            }
+            FftPlanPool::getInstance().setDefaultBackend (FftBackend::Pffft);
+        }
+        else if (arg.startsWith ("--load-test"))
+        {
+            LoadTestOptions loadOptions;
+            const auto seconds = arg.fromFirstOccurrenceOf ("=", false, false).getDoubleValue();
+            if (seconds > 0.0)
+                loadOptions.secondsPerStep = seconds;
+            return runLoadTest (loadOptions, std::cout) > 0 ? 0 : 1;
+        }
+        else if (arg.startsWith ("--accuracy"))
+        {
+            AccuracyTestOptions accuracyOptions;
+            const auto seconds = arg.fromFirstOccurrenceOf ("=", false, false).getDoubleValue();
+            if (seconds > 0.0)
+                accuracyOptions.secondsPerSignal = seconds;
+            return runAccuracyTest (accuracyOptions, std::cout) == 0 ? 0 : 1;
+        }
+        else if (arg.startsWith ("--chunked-test"))
+        {
+            ChunkedTestOptions chunkedOptions;
+            const auto seconds = arg.fromFirstOccurrenceOf ("=", false, false).getDoubleValue();
+            if (seconds > 0.0)
+                chunkedOptions.secondsPerSignal = seconds;
+            return runChunkedTest (chunkedOptions, std::cout) == 0 ? 0 : 1;
+        }
+        else if (arg.startsWith ("--"))
+        {
+            std::cerr << "unknown option " << arg << std::endl;
+            printUsage();
+            return 2;
+        }
+        else
+        {
+            options.files.add (arg);
+        }
+    }
+
+    if (options.files.isEmpty())
+    {
+        printUsage();
+        return 2;
+    }
+
+    std::ofstream profileCsv;
+    if (options.profileCsvPath.isNotEmpty())
+    {
+        profileCsv.open (options.profileCsvPath.toStdString());
+        if (! profileCsv)
+        {
+            std::cerr << "cannot write " << options.profileCsvPath << std::endl;
+            return 2;
+        }
+        StageProfiler::writeCsvHeader (profileCsv);
+    }
+
+    WorkStealingPool pool;
+    double totalAudioSec = 0.0, totalProcessingSec = 0.0;
+    int failures = 0;
+    for (const auto& path : options.files)
+    {
+        const auto file = juce::File::getCurrentWorkingDirectory().getChildFile (path);
+        if (options.verifyChunked)
+        {
+            if (! verifyChunked (file, path, options))
+                ++failures;
+            continue;
+        }
+
+        OfflineAnalysisResult result;
+        juce::String error;
+        const bool ok = options.chunked ? analyseFileChunked (file, options.chunking, result, error)
+                                        : analyseFile (file, pool, result, error);
+        if (! ok)
+        {
+            std::cerr << path << ": " << error << std::endl;
+            ++failures;
+            continue;
+        }
+
+        printTimelines (result, options);
+        if (profileCsv.is_open())
+            StageProfiler::writeCsv (profileCsv, path, result.stageProfile);
+        std::cout << path << ": " << std::fixed << std::setprecision (2) << result.finalBpm << " BPM"
+                  << " (confidence " << std::setprecision (3) << result.finalConfidence << "), "
+                  << result.beats.size() << " beats, " << std::setprecision (1) << result.durationSec << " s audio in "
+                  << std::setprecision (2) << result.processingSec << " s, "
+                  << std::setprecision (1) << result.getRealtimeFactor() << "x real time" << std::endl;
+        totalAudioSec += result.durationSec;
+        totalProcessingSec += result.processingSec;
+    }
+
+    if (options.files.size() > 1 && totalProcessingSec > 0.0)
+        std::cout << "total: " << std::fixed << std::setprecision (1) << totalAudioSec << " s audio in "
+                  << std::setprecision (2) << totalProcessingSec << " s, "
+                  << std::setprecision (1) << totalAudioSec / totalProcessingSec << "x real time ("
+                  << pool.getNumWorkers() << " pool workers)" << std::endl;
+    return failures == 0 ? 0 : 1;
+}
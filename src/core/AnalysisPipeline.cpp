@@ -0,0 +1,259 @@
+#include "AnalysisPipeline.h"
+#include <numeric>
+
+// "deck2", "/deck2/" -> "/deck2"; empty stays empty
+static juce::String normaliseOscPrefix (const juce::String& prefix)
+{
+    auto p = prefix.trim();
+    while (p.endsWithChar ('/'))
+        p = p.dropLastCharacters (1);
+    if (p.isNotEmpty() && ! p.startsWithChar ('/'))
+        p = "/" + p;
+    return p;
+}
+
+AnalysisPipeline::AnalysisPipeline (WorkStealingPool& sharedPool, const juce::String& prefix, Mode modeToUse)
+    : oscPrefix (normaliseOscPrefix (prefix)),
+      mode (modeToUse),
+      pool (sharedPool),
+      onsetAddress (oscPrefix + "/onset"),
+      tempoAddress (oscPrefix + "/tempo"),
+      candidateAddress (oscPrefix + "/tempo/candidate"),
+      beatAddress (oscPrefix + "/beat"),
+      beatCancelAddress (oscPrefix + "/beat/cancel"),
+      statsAddress (oscPrefix + "/stats"),
+      stageStatsAddress (oscPrefix + "/stats/stage")
+{
+    setHighPassHz (20.0f);
+    setLowPassHz (6000.0f);
+}
+
+AnalysisPipeline::~AnalysisPipeline()
+{
+    stop();
+}
+
+void AnalysisPipeline::start()
+{
+    jassert (mode == Mode::Live);
+    if (! dspRunning.exchange (true))
+        dspThread = std::thread ([this] { dspLoop(); });
+    if (! analysisRunning.exchange (true))
+        analysisThread = std::thread ([this] { analysisLoop(); });
+}
+
+void AnalysisPipeline::stop()
+{
+    analysisRunning.store (false);
+    analysisWake.signal();
+    if (analysisThread.joinable()) analysisThread.join();
+
+    dspRunning.store (false);
+    captureFifo.wakeReader();
+    if (dspThread.joinable()) dspThread.join();
+}
+
+bool AnalysisPipeline::connectOsc (const juce::String& host, int port)
+{
+    std::lock_guard<RealtimeSafety::CheckedMutex> lock (analysisMutex);
+    oscConnected = osc.connect (host, port);
+    return oscConnected;
+}
+
+void AnalysisPipeline::setMidiSender (MidiSender sender)
+{
+    std::lock_guard<RealtimeSafety::CheckedMutex> lock (midiMutex);
+    midiSender = std::move (sender);
+}
+
+void AnalysisPipeline::prepare (double sr)
+{
+    const bool rateChanged = sampleRate.exchange (sr) != sr;
+
+    // Keep the analysis thread out and park the DSP thread while the stages are replaced
+    std::lock_guard<RealtimeSafety::CheckedMutex> analysisLock (analysisMutex);
+    const bool parkDsp = dspRunning.load() && std::this_thread::get_id() != dspThread.get_id();
+    if (parkDsp)
+    {
+        dspParkRequested.store (true, std::memory_order_release);
+        captureFifo.wakeReader();
+        while (dspRunning.load() && ! dspParked.load (std::memory_order_acquire))
+            juce::Thread::sleep (1);
+    }
+
+    // Whatever is still buffered was captured at the old rate
+    if (rateChanged)
+        captureFifo.clear();
+
+    {
+        std::lock_guard<RealtimeSafety::CheckedMutex> lock (bandMutex);
+        prefilter.prepare (sr);
+        const int hopHi = juce::jmax (64, (int) juce::roundToInt (sr * 0.005));
+        const int hopLo = juce::jmax (128, (int) juce::roundToInt (sr * 0.010));
+        const int fftHi = fftSizeHi;
+        const int fftLo = fftSizeLo;
+        stftHi = std::make_unique<FixedStftFrontEnd<fftSizeHi>> (hopHi);
+        stftLo = std::make_unique<FixedStftFrontEnd<fftSizeLo>> (hopLo);
+        framesHi.prepare (fftHi, dspChunkSize / hopHi + 1);
+        framesLo.prepare (fftLo, dspChunkSize / hopLo + 1);
+        frameAlignment = std::lcm (hopHi, hopLo);
+        const float bandEdges[numBands + 1] { 20.0f, 150.0f, 400.0f, 800.0f, 2000.0f, 6000.0f };
+        for (size_t b = 0; b < (size_t) numBands; ++b)
+        {
+            bandOnsetsHi[b] = std::make_unique<OnsetDetector> (static_cast<int> (sr), fftHi, hopHi, bandEdges[b], bandEdges[b + 1]);
+            bandOnsetsLo[b] = std::make_unique<OnsetDetector> (static_cast<int> (sr), fftLo, hopLo, bandEdges[b], bandEdges[b + 1]);
+            bandOnsetsHi[b]->setThresholdWindowSeconds (0.75);
+            bandOnsetsLo[b]->setThresholdWindowSeconds (0.75);
+        }
+        tempoWorker = std::make_unique<TempoWorker> (sr, hopHi);
+        tempoWorker->setProfiler (&profiler);
+        if (mode == Mode::Live)
+        {
+            tempoWorker->start();
+        }
+        else
+        {
+            // Offline the worker runs inline; estimate every ~33 ms of audio like the live cadence
+            tempoWorker->setCadence (juce::jmax (1, juce::roundToInt (0.033 * sr / hopHi)), 0.0);
+        }
+    }
+    beatTracker = std::make_unique<BeatTracker> (sr);
+    beatScheduler.reset();
+    fusion.reset();
+    lastTempoVersion = 0;
+    tempoHysteresis.reset();
+    beatCursor.reset();
+
+    capturedSamples.store (0, std::memory_order_relaxed);
+    capturePacketsSinceConfig.store (0, std::memory_order_relaxed);
+    if (parkDsp)
+        dspParkRequested.store (false, std::memory_order_release);
+}
+
+void AnalysisPipeline::pushAudio (const float* interleaved, int frames, int chans, double sr, double qpcSeconds)
+{
+    // A format change reconfigures the pipeline (allocates and locks) before real-time checks apply
+    if (getSampleRate() != sr)
+    {
+        RealtimeSafety::ScopedNonRealtime reconfigure;
+        prepare (sr);
+    }
+
+    RealtimeSafety::ScopedRealtime realtime ("capture", capturePacketsSinceConfig.fetch_add (1, std::memory_order_relaxed) >= rtWarmUpBlocks);
+    StageProfiler::ScopedTimer timer (profiler, StageProfiler::Capture);
+
+    // Downmix straight into the FIFO; nothing is buffered in between
+    auto downmix = [interleaved, chans] (float* dest, int firstFrame, int numFrames)
+    {
+        if (chans <= 1)
+        {
+            juce::FloatVectorOperations::copy (dest, interleaved + firstFrame, numFrames);
+            return;
+        }
+        const float invCh = 1.0f / (float) chans;
+        for (int i = 0; i < numFrames; ++i)
+        {
+            const float* frame = interleaved + (size_t) (firstFrame + i) * (size_t) chans;
+            double sum = 0.0;
+            for (int c = 0; c < chans; ++c)
+                sum += (double) frame[c];
+            dest[i] = (float) (sum * invCh);
+        }
+    };
+    captureFifo.write (frames, downmix);
+
+    const auto endSample = capturedSamples.fetch_add ((uint64_t) frames, std::memory_order_relaxed) + (uint64_t) frames;
+    const double rate = getSampleRate();
+    const double endMonotonicSec = qpcSeconds > 0.0 ? qpcSeconds + frames / rate
+                                                    : juce::Time::getMillisecondCounterHiRes() * 0.001;
+    packetClock.publish ({ (double) endSample / rate, endMonotonicSec });
+}
+
+void AnalysisPipeline::dspLoop()
+{
+    juce::HeapBlock<float> processBlock ((size_t) dspChunkSize);
+    int chunksSinceConfig = 0;
+    while (dspRunning.load())
+    {
+        const int chunk = dspChunkSize;
+        if (dspParkRequested.load (std::memory_order_acquire))
+        {
+            dspParked.store (true, std::memory_order_release);
+            while (dspRunning.load() && dspParkRequested.load (std::memory_order_acquire))
+                juce::Thread::sleep (1);
+            dspParked.store (false, std::memory_order_release);
+            chunksSinceConfig = 0;
+            continue;
+        }
+        if (getSampleRate() <= 0.0)
+        {
+            juce::Thread::sleep (2);
+            continue;
+        }
+        const bool rtArmed = chunksSinceConfig >= rtWarmUpBlocks;
+        RealtimeSafety::ScopedRealtime realtime ("dsp", rtArmed);
+        // Sleeps until capture delivers; a capture stall shows up as an underrun
+        int total = 0;
+        {
+            StageProfiler::ScopedTimer timer (profiler, StageProfiler::FifoWait);
+            total = captureFifo.read (processBlock.get(), chunk, dspWaitTimeoutMs);
+        }
+        if (total <= 0)
+            continue;
+
+        ++chunksSinceConfig;
+        processChunk (processBlock.get(), total, rtArmed);
+    }
+}
+
+void AnalysisPipeline::processOffline (const float* mono, int numSamples)
+{
+    jassert (mode == Mode::Offline && getSampleRate() > 0.0);
+    for (int pos = 0; pos < numSamples; pos += dspChunkSize)
+    {
+        const int n = juce::jmin (dspChunkSize, numSamples - pos);
+        juce::FloatVectorOperations::copy (offlineBlock.get(), mono + pos, n);
+        processChunk (offlineBlock.get(), n, false);
+        capturedSamples.fetch_add ((uint64_t) n, std::memory_order_relaxed);
+        analysisTick();
+    }
+}
+
+// Prefilter, STFTs and band detectors for one chunk; DSP thread (Live) or processOffline()
+void AnalysisPipeline::processChunk (float* samples, int total, bool rtArmed)
+{
+    static_assert (numBands == StageProfiler::numDetectorBands, "one profiler stage per band detector");
+    {
+        StageProfiler::ScopedTimer timer (profiler, StageProfiler::Prefilter);
+        prefilter.processSeries (samples, total);
+    }
+    if (! stftHi || ! stftLo)
+        return;
+
+    // Both resolutions, then every band detector, each as parallel jobs. A detector's
+    // queues see one producer at a time; the pool's join orders successive chunks.
+    const float* audio = samples;
+    pool.parallelFor (2, [&] (int resolution)
+    {
+        RealtimeSafety::ScopedRealtime taskRealtime ("dsp task", rtArmed);
+        StageProfiler::ScopedTimer timer (profiler, resolution == 0 ? StageProfiler::StftHi : StageProfiler::StftLo);
+        auto& frames = resolution == 0 ? framesHi : framesLo;
+        frames.clear();
+        auto keep = [&frames] (const SpectrumFrame& frame) { frames.push (frame); };
+        if (resolution == 0)
+            stftHi->pushAudio (audio, total, keep);
+        else
+            stftLo->pushAudio (audio, total, keep);
+    }, &stftTimings);
+
+    pool.parallelFor (2 * numBands, [&] (int job)
+    {
+        RealtimeSafety::ScopedRealtime taskRealtime ("dsp task", rtArmed);
+        StageProfiler::ScopedTimer timer (profiler, StageProfiler::detectorStage (job % numBands, job < numBands));
+        auto& detector = job < numBands ? bandOnsetsHi[(size_t) job] : bandOnsetsLo[(size_t) (job - numBands)];
+        const auto& frames = job < numBands ? framesHi : framesLo;
+        if (detector)
+            for (int i = 0; i < frames.size(); ++i)
+                detector->processSpectrum (frames[i]);
+    }, &detectorTimings);
+}
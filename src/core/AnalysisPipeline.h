@@ -0,0 +1,217 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "../dsp/StftFrontEnd.h"
+#include "../dsp/BiquadFilterBank.h"
+#include "../dsp/WorkStealingPool.h"
+#include "../dsp/OnsetDetector.h"
+#include "../dsp/OnsetFusion.h"
+#include "../dsp/TempoWorker.h"
+#include "../dsp/BeatTracker.h"
+#include "../dsp/BeatScheduler.h"
+#include "../dsp/Snapshot.h"
+#include "../dsp/CaptureFifo.h"
+#include "../dsp/AllocationCounter.h"
+#include "../dsp/StageProfiler.h"
+#include <array>
+#include <functional>
+#include <memory>
+#include <thread>
+
+// One analysed audio stream, from captured samples to tempo/beat output.
+//
+//   capture thread: pushAudio() downmixes into the capture FIFO
+//   DSP thread:     prefilter, both STFTs, then the ten band detectors (jobs on the shared pool)
+//   analysis thread: flux fusion, onset gating, tempo/beat tracking, OSC/MIDI output and the
+//                    published Snapshot
+//
+// Several pipelines can run in one process, one per source. They share the WorkStealingPool
+// passed in and the FFT plans of FftPlanPool; everything else, including the OSC sender, is per
+// stream. The stream's OSC prefix goes in front of every address ("/deck2" sends /deck2/tempo,
+// /deck2/beat, ...); the default empty prefix keeps the plain addresses.
+//
+// Every stage, from the capture callback to the OSC/MIDI sends, is timed into the stream's
+// StageProfiler: latency histograms and call counts, read through getProfiler() and streamed
+// with the other stats.
+//
+// In Offline mode there are no threads: processOffline() runs the DSP stages and an analysis
+// tick per chunk on the calling thread, with stream time taken from the sample count, so a file
+// is analysed as fast as the CPU allows and with the same result on every run.
+class AnalysisPipeline {
+public:
+    enum class Mode { Live, Offline };
+
+    // Optional hooks, called from the analysis thread (Live) or processOffline()'s caller.
+    // Set them before start() / the first processOffline().
+    struct Events
+    {
+        std::function<void (double timeSec)> onset;                              // gated onset
+        std::function<void (double timeSec, double bpm, double confidence)> tempo; // each new estimate
+        std::function<void (double timeSec, double bpm)> beat;                   // beat grid passed timeSec
+        // The tick at timeSec fed the beat tracker the last numOnsets onsets passed to onset (only
+        // ticks with onsets). With tempo, which follows in the same tick, this is all the tracker
+        // sees, so its beat grid can be rebuilt without the DSP.
+        std::function<void (double timeSec, int numOnsets)> onsetBatch;
+    };
+
+    // What a stream's consumers (UI, load test) read; written by the analysis thread only
+    struct Snapshot
+    {
+        double bpm { -1.0 };
+        double confidence { 0.0 };
+        double streamTimeSec { 0.0 };
+        double nextBeatSec { -1.0 };
+        double beatPhase { 0.0 };                    // 0..1 within the current beat
+        std::array<float, 5> bandActivity {};        // 0..1 onset activity per band
+    };
+
+    static constexpr int numBands = 5;
+    static constexpr int fftSizeHi = 1024;
+    static constexpr int fftSizeLo = 2048;
+    static constexpr int dspChunkSize = 512;
+    static constexpr int rtWarmUpBlocks = 16;
+    static constexpr int dspWaitTimeoutMs = 50; // longer without audio counts as a capture stall
+    static constexpr double statsIntervalMs = 1000.0;
+
+    AnalysisPipeline(WorkStealingPool& sharedPool, const juce::String& oscPrefix = {}, Mode mode = Mode::Live);
+    ~AnalysisPipeline();
+
+    const juce::String& getOscPrefix() const noexcept { return oscPrefix; }
+
+    // DSP and analysis threads
+    void start();
+    void stop();
+
+    // (Re)builds the pipeline for a sample rate. Safe while running: parks the DSP thread and
+    // keeps the analysis thread out until the new stages are in place.
+    void prepare(double sampleRate);
+    double getSampleRate() const noexcept { return sampleRate.load(std::memory_order_relaxed); }
+
+    // Capture side, one producer thread. Reconfigures first if the sample rate changed.
+    // qpcSeconds: device time of the packet's first frame (QueryPerformanceCounter seconds, the
+    // clock of Time::getMillisecondCounterHiRes on Windows), or 0 if the API gives none.
+    void pushAudio(const float* interleaved, int frames, int channels, double sampleRate, double qpcSeconds = 0.0);
+
+    // Offline mode: analyses mono samples synchronously, continuing from the previous call
+    void processOffline(const float* mono, int numSamples);
+    void setEvents(Events newEvents) { events = std::move(newEvents); }
+    double getStreamTimeSec() const noexcept
+    {
+        return (double) capturedSamples.load(std::memory_order_relaxed) / juce::jmax(1.0, getSampleRate());
+    }
+    // Samples after which both STFT hops are back in phase (set by prepare). An offline run
+    // started at a multiple of it puts its spectrum frames, and so its onset times, on the same
+    // samples as a run from sample 0.
+    int getFrameAlignment() const noexcept { return frameAlignment; }
+
+    // Outputs
+    bool connectOsc(const juce::String& host, int port);
+    // MIDI goes through a sender so the core does not depend on audio devices; the app wraps a
+    // juce::MidiOutput. Setting a new sender (or none) waits for a send in progress.
+    using MidiSender = std::function<void (const juce::MidiBuffer&)>;
+    void setMidiSender(MidiSender sender);
+    void setSendTempoCandidates(bool shouldSend) noexcept { sendTempoCandidates.store(shouldSend); }
+    // Deprecated: also sends each onset as /beat t, the address's meaning before /onset existed.
+    // Old receivers keep working; /beat t has one float argument, a scheduled beat three.
+    void setSendLegacyBeatOnsets(bool shouldSend) noexcept { sendLegacyBeatOnsets.store(shouldSend); }
+    void setAnalysisRateHz(int hz) noexcept { analysisRateHz.store(juce::jlimit(1, 1000, hz)); }
+
+    // Prefilter targets (HPF in lane 0, LPF in lane 1); the DSP thread glides to them
+    void setHighPassHz(float hz) noexcept { prefilter.setSection(0, BiquadFilterBank::Type::HighPass, hz); }
+    void setLowPassHz(float hz) noexcept  { prefilter.setSection(1, BiquadFilterBank::Type::LowPass, hz); }
+
+    Snapshot getSnapshot() const noexcept { return snapshot.read(); }
+    uint64_t getSnapshotVersion() const noexcept { return snapshot.getVersion(); }
+    CaptureFifo& getCaptureFifo() noexcept { return captureFifo; }
+    const CaptureFifo& getCaptureFifo() const noexcept { return captureFifo; }
+    const TaskTimings& getStftTimings() const noexcept { return stftTimings; }
+    const TaskTimings& getDetectorTimings() const noexcept { return detectorTimings; }
+    StageProfiler& getProfiler() noexcept { return profiler; }
+    const StageProfiler& getProfiler() const noexcept { return profiler; }
+
+private:
+    void dspLoop();
+    void processChunk(float* samples, int numSamples, bool rtArmed);
+    void emitBeats(double streamNowSec);
+    void analysisLoop();
+    void analysisTick();
+    void sendScheduledBeats(double streamNowSec);
+    void sendCaptureStats();
+    void sendStageStats();
+
+    const juce::String oscPrefix;
+    const Mode mode;
+    WorkStealingPool& pool;
+    std::atomic<double> sampleRate { 0.0 };
+    StageProfiler profiler; // before the stages that record into it
+
+    // Capture->DSP handoff (mono): starts at 16384 samples and grows on overrun up to 131072
+    CaptureFifo captureFifo { 1 << 14, 1 << 17 };
+    std::atomic<int> capturePacketsSinceConfig { 0 };
+    std::atomic<uint64_t> capturedSamples { 0 };
+    // End of the latest capture packet: its stream time, and the same instant on the
+    // getMillisecondCounterHiRes clock in seconds (the device timestamp where the capture API
+    // gives one, else the packet's arrival). The beat scheduler's stream -> wall clock.
+    struct PacketClock { double streamSec; double monotonicSec; };
+    SeqlockSnapshot<PacketClock> packetClock;
+
+    // Band limiting: HPF (lane 0) -> LPF (lane 1)
+    BiquadFilterBank prefilter { BiquadFilterBank::Topology::Series, 2 };
+
+    // Multiresolution multiband onset detection: 20-150, 150-400, 400-800, 800-2000, 2000-6000 Hz
+    // One STFT per resolution; its spectrum is sliced into band bin ranges by the detectors.
+    std::unique_ptr<FixedStftFrontEnd<fftSizeHi>> stftHi;
+    std::unique_ptr<FixedStftFrontEnd<fftSizeLo>> stftLo;
+    std::array<std::unique_ptr<OnsetDetector>, numBands> bandOnsetsHi;
+    std::array<std::unique_ptr<OnsetDetector>, numBands> bandOnsetsLo;
+    SpectrumFrameBuffer framesHi, framesLo;
+    TaskTimings stftTimings, detectorTimings;
+    RealtimeSafety::CheckedMutex bandMutex; // guards the detectors between the analysis thread and prepare
+
+    // Tempo estimation runs on its own worker; the analysis thread only queues input and reads snapshots
+    std::unique_ptr<TempoWorker> tempoWorker;
+    std::unique_ptr<BeatTracker> beatTracker;
+    BeatScheduler beatScheduler; // look-ahead /beat bundles from the tracker's beat grid
+
+    OnsetFusion fusion; // flux fusion and onset gating (analysis thread)
+
+    Events events;
+    BeatGridCursor beatCursor; // beats passed to events.beat
+
+    // Tempo hysteresis (analysis thread)
+    uint64_t lastTempoVersion { 0 };
+    TempoHysteresis tempoHysteresis;
+
+    // OSC; addresses carry the stream prefix
+    juce::OSCSender osc;
+    bool oscConnected { false };
+    std::atomic<bool> sendTempoCandidates { false };
+    std::atomic<bool> sendLegacyBeatOnsets { false };
+    const juce::OSCAddressPattern onsetAddress, tempoAddress, candidateAddress, beatAddress, beatCancelAddress, statsAddress, stageStatsAddress;
+    double lastStatsSentMs { 0.0 };
+
+    // MIDI; midiMutex guards swapping the sender against sends from the analysis thread
+    RealtimeSafety::CheckedMutex midiMutex;
+    MidiSender midiSender;
+    int midiCcForTempo { 20 };
+    int midiChannel { 1 };
+    int midiBeatNote { 60 }; // C4 for beat pulses
+
+    SeqlockSnapshot<Snapshot> snapshot;
+    juce::HeapBlock<float> offlineBlock { (size_t) dspChunkSize };
+    int frameAlignment { 1 };
+
+    // Threads. The DSP thread takes no locks: prepare() parks it (dspParkRequested/dspParked)
+    // while the stages are replaced. Real-time checks arm after rtWarmUpBlocks chunks/packets.
+    std::thread dspThread;
+    std::atomic<bool> dspRunning { false };
+    std::atomic<bool> dspParkRequested { false };
+    std::atomic<bool> dspParked { false };
+    std::thread analysisThread;
+    std::atomic<bool> analysisRunning { false };
+    juce::WaitableEvent analysisWake;
+    RealtimeSafety::CheckedMutex analysisMutex; // held for each tick; prepare takes it to swap the stages
+    std::atomic<int> analysisRateHz { 100 };
+
+    JUCE_DECLARE_NON_COPYABLE (AnalysisPipeline)
+};
@@ -0,0 +1,492 @@
+#include "OfflineAnalysis.h"
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <thread>
+
+namespace
+{
+    constexpr int readBlockFrames = 65536;
+
+    // Onsets one analysis tick fed the beat tracker (AnalysisPipeline::Events::onsetBatch):
+    // [firstOnset, firstOnset + numOnsets) of the result's onset list
+    struct OnsetBatch
+    {
+        double timeSec;
+        size_t firstOnset;
+        int numOnsets;
+    };
+
+    // Collects the pipeline's output into result, shifted by offsetSec. With batches, also logs
+    // which tick fed which onsets to the beat tracker.
+    void collectEvents (AnalysisPipeline& pipeline, OfflineAnalysisResult& result, double offsetSec,
+                        std::vector<OnsetBatch>* batches = nullptr)
+    {
+        AnalysisPipeline::Events events;
+        events.onset = [&result, offsetSec] (double t) { result.onsets.push_back (offsetSec + t); };
+        events.tempo = [&result, offsetSec] (double t, double bpm, double conf) { result.tempo.push_back ({ offsetSec + t, bpm, conf }); };
+        events.beat  = [&result, offsetSec] (double t, double) { result.beats.push_back (offsetSec + t); };
+        if (batches != nullptr)
+            events.onsetBatch = [&result, batches, offsetSec] (double t, int numOnsets)
+            {
+                batches->push_back ({ offsetSec + t, result.onsets.size() - (size_t) numOnsets, numOnsets });
+            };
+        pipeline.setEvents (std::move (events));
+    }
+
+    // Fills mono with frames [pos, pos + n) of the recording, downmixed
+    using MonoSource = std::function<void (float* mono, juce::int64 pos, int n)>;
+
+    // Channel mean, as the live capture path downmixes
+    MonoSource downmix (juce::AudioFormatReader& reader)
+    {
+        const int channels = juce::jmax (1, (int) reader.numChannels);
+        auto block = std::make_shared<juce::AudioBuffer<float>> (channels, readBlockFrames);
+        return [&reader, channels, block] (float* mono, juce::int64 pos, int n)
+        {
+            reader.read (block.get(), 0, n, pos, true, true);
+            juce::FloatVectorOperations::copy (mono, block->getReadPointer (0), n);
+            for (int c = 1; c < channels; ++c)
+                juce::FloatVectorOperations::add (mono, block->getReadPointer (c), n);
+            if (channels > 1)
+                juce::FloatVectorOperations::multiply (mono, 1.0f / (float) channels, n);
+        };
+    }
+
+    MonoSource fromMemory (const float* samples)
+    {
+        return [samples] (float* mono, juce::int64 pos, int n) { juce::FloatVectorOperations::copy (mono, samples + pos, n); };
+    }
+
+    // Frames [start, end) of the source through a fresh pipeline; times are recording times
+    OfflineAnalysisResult analyseRange (const MonoSource& source, double sampleRate, juce::int64 start, juce::int64 end,
+                                        WorkStealingPool& pool, std::vector<OnsetBatch>* batches = nullptr)
+    {
+        OfflineAnalysisResult result;
+        result.sampleRate = sampleRate;
+        result.durationSec = (double) (end - start) / sampleRate;
+
+        AnalysisPipeline pipeline (pool, {}, AnalysisPipeline::Mode::Offline);
+        collectEvents (pipeline, result, (double) start / sampleRate, batches);
+        pipeline.prepare (sampleRate);
+
+        juce::HeapBlock<float> mono ((size_t) readBlockFrames);
+
+        // Blocks end on multiples of readBlockFrames in the recording, so the pipeline's DSP
+        // chunks, and with them the analysis ticks, fall on the same samples whatever the start
+        static_assert (readBlockFrames % AnalysisPipeline::dspChunkSize == 0, "blocks must hold whole DSP chunks");
+        const double startMs = juce::Time::getMillisecondCounterHiRes();
+        for (juce::int64 pos = start; pos < end;)
+        {
+            const int n = (int) juce::jmin<juce::int64> (readBlockFrames - pos % readBlockFrames, end - pos);
+            source (mono.get(), pos, n);
+            pipeline.processOffline (mono.get(), n);
+            pos += n;
+        }
+        result.processingSec = (juce::Time::getMillisecondCounterHiRes() - startMs) * 0.001;
+
+        const auto snap = pipeline.getSnapshot();
+        result.finalBpm = snap.bpm;
+        result.finalConfidence = snap.confidence;
+        result.stageProfile = pipeline.getProfiler().getSummaries();
+        return result;
+    }
+
+    // A reader over [start, end) of the file: a memory-mapped section where the format
+    // supports it, otherwise an ordinary reader. Each chunk gets its own, so chunks read
+    // concurrently without sharing any reader state.
+    std::unique_ptr<juce::AudioFormatReader> openSection (juce::AudioFormatManager& formats, const juce::File& file,
+                                                          juce::int64 start, juce::int64 end)
+    {
+        if (auto* format = formats.findFormatForFileExtension (file.getFileExtension()))
+        {
+            std::unique_ptr<juce::MemoryMappedAudioFormatReader> mapped (format->createMemoryMappedReader (file));
+            if (mapped != nullptr && mapped->mapSectionOfFile ({ start, end }))
+                return mapped;
+        }
+        return std::unique_ptr<juce::AudioFormatReader> (formats.createReaderFor (file));
+    }
+
+    struct Chunk
+    {
+        juce::int64 keepStart, keepEnd;  // the part this chunk reports
+        juce::int64 readStart, readEnd;  // plus warm-up before and the shared stretch after
+    };
+
+    struct ChunkResult
+    {
+        OfflineAnalysisResult analysis;
+        std::vector<OnsetBatch> batches;
+    };
+
+    // Chunks start on the same tick grid, so a tick both report has the same time up to rounding
+    constexpr double sameTickSec = 1.0e-6;
+
+    bool sameOnsets (const OnsetBatch& a, const std::vector<double>& aOnsets,
+                     const OnsetBatch& b, const std::vector<double>& bOnsets, double tol)
+    {
+        if (a.numOnsets != b.numOnsets)
+            return false;
+        for (int i = 0; i < a.numOnsets; ++i)
+            if (std::abs (aOnsets[a.firstOnset + (size_t) i] - bOnsets[b.firstOnset + (size_t) i]) > tol)
+                return false;
+        return true;
+    }
+
+    // batches/onsets end with the earlier chunk's; later is the next chunk. Cuts both after the
+    // first batch in [from, to) that both chunks fed at the same tick, and continues with the
+    // later chunk's; without one, cuts at from. Returns the time before which events come from
+    // the earlier chunk; agreed is false if the chunks had onsets in [from, to) but none in common.
+    double stitchBatches (std::vector<OnsetBatch>& batches, std::vector<double>& onsets, const ChunkResult& later,
+                          double from, double to, double tol, bool& agreed)
+    {
+        const auto& laterBatches = later.batches;
+        const auto& laterOnsets = later.analysis.onsets;
+        auto byTime = [] (const OnsetBatch& batch, double t) { return batch.timeSec < t; };
+
+        auto keep = (size_t) (std::lower_bound (batches.begin(), batches.end(), from, byTime) - batches.begin());
+        auto laterKeep = (size_t) (std::lower_bound (laterBatches.begin(), laterBatches.end(), from, byTime) - laterBatches.begin());
+        const bool hadOnsets = (keep < batches.size() && batches[keep].timeSec < to)
+                            || (laterKeep < laterBatches.size() && laterBatches[laterKeep].timeSec < to);
+        double cut = from;
+        agreed = false;
+        for (size_t i = keep; i < batches.size() && batches[i].timeSec < to && ! agreed; ++i)
+        {
+            const auto match = std::lower_bound (laterBatches.begin(), laterBatches.end(), batches[i].timeSec - sameTickSec, byTime);
+            if (match != laterBatches.end() && std::abs (match->timeSec - batches[i].timeSec) < sameTickSec
+                && sameOnsets (batches[i], onsets, *match, laterOnsets, tol))
+            {
+                keep = i + 1;
+                laterKeep = (size_t) (match - laterBatches.begin()) + 1;
+                cut = batches[i].timeSec + sameTickSec;
+                agreed = true;
+            }
+        }
+        agreed = agreed || ! hadOnsets;
+
+        onsets.resize (keep < batches.size() ? batches[keep].firstOnset : onsets.size());
+        batches.resize (keep);
+        const size_t laterFirstOnset = laterKeep < laterBatches.size() ? laterBatches[laterKeep].firstOnset : laterOnsets.size();
+        for (size_t j = laterKeep; j < laterBatches.size(); ++j)
+        {
+            auto batch = laterBatches[j];
+            batch.firstOnset = batch.firstOnset - laterFirstOnset + onsets.size();
+            batches.push_back (batch);
+        }
+        onsets.insert (onsets.end(), laterOnsets.begin() + (long) laterFirstOnset, laterOnsets.end());
+        return cut;
+    }
+
+    // The beat tracker keeps its lock and phase for good, so no warm-up makes a chunk's beat
+    // grid match a sequential pass. It needs no DSP though: the grid is rebuilt by feeding one
+    // tracker the stitched onset batches and tempo estimates in order, tick by tick, as the
+    // pipeline's analysis tick does (onsets, then the estimate through the hysteresis).
+    std::vector<double> replayBeats (const std::vector<OnsetBatch>& batches, const std::vector<double>& onsets,
+                                     const std::vector<OfflineAnalysisResult::TempoPoint>& tempo,
+                                     double sampleRate, double endSec)
+    {
+        const double tickSec = AnalysisPipeline::dspChunkSize / sampleRate;
+        BeatTracker tracker (sampleRate);
+        BeatGridCursor cursor;
+        TempoHysteresis hysteresis;
+        std::vector<double> beats, batchOnsets;
+        auto collect = [&beats] (double t, double) { beats.push_back (t); };
+
+        size_t b = 0, e = 0;
+        while (b < batches.size() || e < tempo.size())
+        {
+            const double tick = juce::jmin (b < batches.size() ? batches[b].timeSec : endSec,
+                                            e < tempo.size() ? tempo[e].timeSec : endSec);
+            // The ticks since the previous input walked the grid as it was
+            cursor.advance (tracker, tick - tickSec, collect);
+            if (b < batches.size() && batches[b].timeSec < tick + sameTickSec)
+            {
+                const auto first = onsets.begin() + (long) batches[b].firstOnset;
+                batchOnsets.assign (first, first + batches[b].numOnsets);
+                tracker.onOnsets (batchOnsets);
+                ++b;
+            }
+            if (e < tempo.size() && tempo[e].timeSec < tick + sameTickSec)
+            {
+                if (hysteresis.onEstimate (tempo[e].bpm, tempo[e].confidence))
+                    tracker.updateBpm (tempo[e].bpm);
+                ++e;
+            }
+            cursor.advance (tracker, tick, collect);
+        }
+        cursor.advance (tracker, endSec, collect);
+        return beats;
+    }
+
+    // Last estimate at or before t, or -1
+    double bpmAt (const std::vector<OfflineAnalysisResult::TempoPoint>& tempo, double t)
+    {
+        const auto it = std::upper_bound (tempo.begin(), tempo.end(), t,
+                                          [] (double time, const OfflineAnalysisResult::TempoPoint& p) { return time < p.timeSec; });
+        return it == tempo.begin() ? -1.0 : std::prev (it)->bpm;
+    }
+
+    // Events of reference with a partner in other within tol; also tracks the largest error
+    int countMatched (const std::vector<double>& reference, const std::vector<double>& other, double tol, double* maxError)
+    {
+        int matched = 0;
+        for (double t : reference)
+        {
+            const auto it = std::lower_bound (other.begin(), other.end(), t - tol);
+            if (it != other.end() && std::abs (*it - t) <= tol)
+            {
+                ++matched;
+                if (maxError != nullptr)
+                    *maxError = juce::jmax (*maxError, std::abs (*it - t));
+            }
+        }
+        return matched;
+    }
+    // Analyses one chunk (with its warm-up and shared stretch) into result; false on a read error
+    using ChunkAnalyser = std::function<bool (const Chunk& chunk, WorkStealingPool& pool, ChunkResult& result)>;
+
+    // Cuts [0, total) into chunks, analyses them concurrently and stitches them into result,
+    // which must hold the sample rate and duration already. False if a chunk failed.
+    bool analyseInChunks (juce::int64 total, double sr, const ChunkedAnalysisOptions& options,
+                          const ChunkAnalyser& analyseChunk, OfflineAnalysisResult& result)
+    {
+        // Chunk boundaries and warm-up starts sit on the pipeline's frame alignment
+        juce::int64 alignment = 1;
+        {
+            WorkStealingPool inlinePool (0);
+            AnalysisPipeline probe (inlinePool, {}, AnalysisPipeline::Mode::Offline);
+            probe.prepare (sr);
+            alignment = probe.getFrameAlignment();
+        }
+        auto alignDown = [alignment] (juce::int64 pos) { return pos - pos % alignment; };
+
+        const int numThreads = options.numThreads > 0 ? options.numThreads
+                                                      : juce::jmax (1, (int) std::thread::hardware_concurrency());
+        const auto perThread = (juce::int64) std::ceil ((double) total / numThreads);
+        const auto chunkFrames = juce::jmax ((juce::int64) (options.minChunkSec * sr),
+                                             juce::jmin ((juce::int64) (options.chunkSec * sr), perThread),
+                                             alignment);
+        const auto warmUp = (juce::int64) (options.warmUpSec * sr);
+        const auto shared = (juce::int64) (options.sharedSec * sr);
+
+        std::vector<Chunk> chunks;
+        for (juce::int64 start = 0; start < total;)
+        {
+            juce::int64 end = alignDown (start + chunkFrames);
+            if (end <= start || total - end < chunkFrames / 4)
+                end = total; // no sliver of a last chunk
+            chunks.push_back ({ start, end, alignDown (juce::jmax<juce::int64> (0, start - warmUp)), juce::jmin (total, end + shared) });
+            start = end;
+        }
+
+        // One pipeline per thread, each on an inline pool: the chunks are the parallelism
+        std::vector<ChunkResult> chunkResults (chunks.size());
+        std::atomic<bool> failed { false };
+        auto analyseAll = [&] (const std::vector<size_t>& indices)
+        {
+            std::atomic<size_t> next { 0 };
+            auto work = [&]
+            {
+                WorkStealingPool inlinePool (0);
+                for (size_t k = next.fetch_add (1); k < indices.size(); k = next.fetch_add (1))
+                    if (! analyseChunk (chunks[indices[k]], inlinePool, chunkResults[indices[k]]))
+                        failed.store (true);
+            };
+            std::vector<std::thread> threads;
+            for (int t = 1; t < juce::jmin (numThreads, (int) indices.size()); ++t)
+                threads.emplace_back (work);
+            work();
+            for (auto& t : threads)
+                t.join();
+        };
+
+        const double startMs = juce::Time::getMillisecondCounterHiRes();
+        std::vector<size_t> all (chunks.size());
+        for (size_t i = 0; i < chunks.size(); ++i)
+            all[i] = i;
+        analyseAll (all);
+        if (failed.load())
+            return false;
+
+        // The tempo estimator remembers onsets, not time: a warm-up holding fewer than it
+        // remembers starts the chunk with part of that memory missing, and the tempo and beats
+        // after the seam cannot converge. Such warm-ups are extended by whole warm-ups (counted
+        // on the first pass's kept onsets) and their chunks analysed again.
+        std::vector<double> keptOnsets;
+        for (size_t i = 0; i < chunks.size(); ++i)
+            for (double t : chunkResults[i].analysis.onsets)
+                if (t >= (double) chunks[i].keepStart / sr && t < (double) chunks[i].keepEnd / sr)
+                    keptOnsets.push_back (t);
+
+        std::vector<size_t> extended;
+        const auto step = juce::jmax (warmUp, alignment);
+        for (size_t i = 1; i < chunks.size(); ++i)
+        {
+            const auto onsetsBefore = [&] (juce::int64 from)
+            {
+                return (size_t) (std::lower_bound (keptOnsets.begin(), keptOnsets.end(), (double) chunks[i].keepStart / sr)
+                                 - std::lower_bound (keptOnsets.begin(), keptOnsets.end(), (double) from / sr));
+            };
+            auto& chunk = chunks[i];
+            const auto readStart = chunk.readStart;
+            while (chunk.readStart > 0 && onsetsBefore (chunk.readStart) < TempoEstimator::defaultRecentOnsets)
+                chunk.readStart = alignDown (juce::jmax<juce::int64> (0, chunk.readStart - step));
+            if (chunk.readStart != readStart)
+                extended.push_back (i);
+        }
+        if (! extended.empty())
+        {
+            for (size_t i : extended)
+                chunkResults[i] = {};
+            analyseAll (extended);
+            if (failed.load())
+                return false;
+        }
+
+        // Stitch: the first chunk whole, then each seam cut inside the shared stretch
+        auto batches = std::move (chunkResults.front().batches);
+        result.onsets = std::move (chunkResults.front().analysis.onsets);
+        result.tempo = std::move (chunkResults.front().analysis.tempo);
+        for (size_t i = 1; i < chunks.size(); ++i)
+        {
+            const double from = (double) chunks[i].keepStart / sr;
+            const double to = (double) chunks[i - 1].readEnd / sr;
+            const auto& later = chunkResults[i];
+
+            bool agreed = false;
+            const double cut = stitchBatches (batches, result.onsets, later, from, to, options.seamToleranceSec, agreed);
+
+            auto byTime = [] (const OfflineAnalysisResult::TempoPoint& p, double t) { return p.timeSec < t; };
+            const auto& laterTempo = later.analysis.tempo;
+            result.tempo.erase (std::lower_bound (result.tempo.begin(), result.tempo.end(), cut, byTime), result.tempo.end());
+            result.tempo.insert (result.tempo.end(), std::lower_bound (laterTempo.begin(), laterTempo.end(), cut, byTime), laterTempo.end());
+
+            ++result.numSeams;
+            if (! agreed)
+                ++result.unmatchedSeams;
+        }
+        result.beats = replayBeats (batches, result.onsets, result.tempo, sr, result.durationSec);
+        result.processingSec = (juce::Time::getMillisecondCounterHiRes() - startMs) * 0.001;
+        result.finalBpm = chunkResults.back().analysis.finalBpm;
+        result.finalConfidence = chunkResults.back().analysis.finalConfidence;
+        return true;
+    }
+}
+
+OfflineAnalysisResult analyseReader (juce::AudioFormatReader& reader, WorkStealingPool& pool)
+{
+    if (reader.sampleRate <= 0.0 || reader.lengthInSamples <= 0)
+    {
+        OfflineAnalysisResult result;
+        result.sampleRate = reader.sampleRate;
+        return result;
+    }
+    return analyseRange (downmix (reader), reader.sampleRate, 0, reader.lengthInSamples, pool);
+}
+
+OfflineAnalysisResult analyseSamples (const float* mono, juce::int64 numSamples, double sampleRate, WorkStealingPool& pool)
+{
+    if (sampleRate <= 0.0 || numSamples <= 0)
+    {
+        OfflineAnalysisResult result;
+        result.sampleRate = sampleRate;
+        return result;
+    }
+    return analyseRange (fromMemory (mono), sampleRate, 0, numSamples, pool);
+}
+
+bool analyseFile (const juce::File& file, WorkStealingPool& pool, OfflineAnalysisResult& result, juce::String& error)
+{
+    juce::AudioFormatManager formats;
+    formats.registerBasicFormats();
+    std::unique_ptr<juce::AudioFormatReader> reader (formats.createReaderFor (file));
+    if (reader == nullptr)
+    {
+        error = file.existsAsFile() ? "unsupported or unreadable audio file" : "file not found";
+        return false;
+    }
+    result = analyseReader (*reader, pool);
+    return true;
+}
+
+bool analyseFileChunked (const juce::File& file, const ChunkedAnalysisOptions& options,
+                         OfflineAnalysisResult& result, juce::String& error)
+{
+    juce::AudioFormatManager formats;
+    formats.registerBasicFormats();
+    std::unique_ptr<juce::AudioFormatReader> header (formats.createReaderFor (file));
+    if (header == nullptr)
+    {
+        error = file.existsAsFile() ? "unsupported or unreadable audio file" : "file not found";
+        return false;
+    }
+    const double sr = header->sampleRate;
+    const juce::int64 total = header->lengthInSamples;
+    header.reset();
+
+    result = {};
+    result.sampleRate = sr;
+    result.durationSec = sr > 0.0 ? (double) total / sr : 0.0;
+    if (sr <= 0.0 || total <= 0)
+        return true;
+
+    auto analyseChunk = [&formats, &file, sr] (const Chunk& chunk, WorkStealingPool& pool, ChunkResult& chunkResult)
+    {
+        auto reader = openSection (formats, file, chunk.readStart, chunk.readEnd);
+        if (reader == nullptr)
+            return false;
+        chunkResult.analysis = analyseRange (downmix (*reader), sr, chunk.readStart, chunk.readEnd, pool, &chunkResult.batches);
+        return true;
+    };
+    if (! analyseInChunks (total, sr, options, analyseChunk, result))
+    {
+        error = "could not reopen the file for a chunk";
+        return false;
+    }
+    return true;
+}
+
+OfflineAnalysisResult analyseSamplesChunked (const float* mono, juce::int64 numSamples, double sampleRate,
+                                             const ChunkedAnalysisOptions& options)
+{
+    OfflineAnalysisResult result;
+    result.sampleRate = sampleRate;
+    if (sampleRate <= 0.0 || numSamples <= 0)
+        return result;
+    result.durationSec = (double) numSamples / sampleRate;
+
+    auto analyseChunk = [mono, sampleRate] (const Chunk& chunk, WorkStealingPool& pool, ChunkResult& chunkResult)
+    {
+        chunkResult.analysis = analyseRange (fromMemory (mono), sampleRate, chunk.readStart, chunk.readEnd, pool, &chunkResult.batches);
+        return true;
+    };
+    analyseInChunks (numSamples, sampleRate, options, analyseChunk, result);
+    return result;
+}
+
+OfflineComparison compareResults (const OfflineAnalysisResult& reference, const OfflineAnalysisResult& other,
+                                  double timeToleranceSec, double bpmTolerance)
+{
+    OfflineComparison c;
+
+    // Extra events in other count against it as much as missing ones
+    c.onsetsCompared = (int) juce::jmax (reference.onsets.size(), other.onsets.size());
+    c.onsetsMatched = countMatched (reference.onsets, other.onsets, timeToleranceSec, &c.maxOnsetErrorSec);
+    c.beatsCompared = (int) juce::jmax (reference.beats.size(), other.beats.size());
+    c.beatsMatched = countMatched (reference.beats, other.beats, timeToleranceSec, nullptr);
+
+    const auto firstEstimate = std::find_if (reference.tempo.begin(), reference.tempo.end(),
+                                             [] (const OfflineAnalysisResult::TempoPoint& p) { return p.bpm > 0.0; });
+    if (firstEstimate != reference.tempo.end())
+    {
+        for (double t = firstEstimate->timeSec; t < reference.durationSec; t += 0.1)
+        {
+            const double error = std::abs (bpmAt (other.tempo, t) - bpmAt (reference.tempo, t));
+            ++c.bpmSamples;
+            if (error <= bpmTolerance)
+                ++c.bpmSamplesMatched;
+            c.maxBpmError = juce::jmax (c.maxBpmError, error);
+        }
+    }
+    return c;
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "AnalysisPipeline.h"
+#include <vector>
+
+// Runs a whole recording through an Offline-mode AnalysisPipeline on the calling thread (the
+// DSP jobs still go to the pool) and collects what a live stream would have sent: the tempo
+// timeline, the beat grid and the gated onsets, all in seconds from the start of the file.
+struct OfflineAnalysisResult
+{
+    struct TempoPoint
+    {
+        double timeSec { 0.0 };
+        double bpm { -1.0 };
+        double confidence { 0.0 };
+    };
+
+    double sampleRate { 0.0 };
+    double durationSec { 0.0 };
+    double processingSec { 0.0 };  // wall time spent analysing, excluding opening the file
+    double finalBpm { -1.0 };
+    double finalConfidence { 0.0 };
+    std::vector<TempoPoint> tempo;
+    std::vector<double> beats;
+    std::vector<double> onsets;
+
+    // Per-stage timing of the pipeline (sequential analysis only; chunks run one pipeline each)
+    std::vector<StageProfiler::StageSummary> stageProfile;
+
+    // Chunked analysis only: seams, and seams where the chunks never agreed within the overlap
+    int numSeams { 0 };
+    int unmatchedSeams { 0 };
+
+    // Seconds of audio analysed per second of wall time
+    double getRealtimeFactor() const noexcept { return processingSec > 0.0 ? durationSec / processingSec : 0.0; }
+};
+
+// Reads the source in blocks and downmixes to mono; any channel count and sample rate
+OfflineAnalysisResult analyseReader(juce::AudioFormatReader& reader, WorkStealingPool& pool);
+
+// Mono samples already in memory (test signals, other decoders)
+OfflineAnalysisResult analyseSamples(const float* mono, juce::int64 numSamples, double sampleRate, WorkStealingPool& pool);
+
+// WAV/AIFF (and the other formats registerBasicFormats() knows). Returns false with a message
+// in error if the file cannot be opened.
+bool analyseFile(const juce::File& file, WorkStealingPool& pool, OfflineAnalysisResult& result, juce::String& error);
+
+// Chunk-parallel analysis for long recordings. The file is memory-mapped (WAV/AIFF; other
+// formats get one reader per chunk) and cut into chunks that are analysed concurrently, one
+// pipeline per thread. Each chunk also analyses warmUpSec before its start, so its detectors
+// and tempo state have settled by then, and sharedSec past its end. Across that shared stretch
+// both neighbours are settled: the stitch cuts onsets and tempo after the first tick at which
+// both fed the beat tracker the same onsets and continues with the later chunk, so nothing is
+// doubled or lost at a seam. Chunk starts are rounded to the pipeline's frame alignment, so
+// onset times match a sequential pass exactly once the warm-up has converged. The beat grid
+// is then rebuilt from the stitched onsets and tempo estimates in one pass, which is cheap
+// and, unlike per-chunk beats, does not depend on where a chunk started. The tempo estimator
+// remembers its last 64 onsets rather than a fixed time, so on sparser material a chunk's
+// warm-up is extended backwards, a warm-up at a time, until it holds that many (or reaches the
+// start) and the chunk is analysed again.
+struct ChunkedAnalysisOptions
+{
+    double chunkSec { 600.0 };   // longest chunk; shorter when that leaves threads idle
+    double minChunkSec { 120.0 };
+    double warmUpSec { 30.0 };
+    double sharedSec { 10.0 };
+    double seamToleranceSec { 0.010 }; // events this close count as the same event
+    int numThreads { 0 };        // 0 = one per core
+};
+
+bool analyseFileChunked(const juce::File& file, const ChunkedAnalysisOptions& options,
+                        OfflineAnalysisResult& result, juce::String& error);
+
+// The same over mono samples already in memory, so the chunking can be checked against
+// analyseSamples without a file
+OfflineAnalysisResult analyseSamplesChunked(const float* mono, juce::int64 numSamples, double sampleRate,
+                                            const ChunkedAnalysisOptions& options);
+
+// How far other departs from reference (normally a sequential pass)
+struct OfflineComparison
+{
+    int onsetsCompared { 0 };
+    int onsetsMatched { 0 };       // an onset of other within the tolerance
+    double maxOnsetErrorSec { 0.0 };
+    int beatsCompared { 0 };
+    int beatsMatched { 0 };
+    int bpmSamples { 0 };          // tempo curves sampled every 100 ms from the first estimate
+    int bpmSamplesMatched { 0 };   // within bpmTolerance
+    double maxBpmError { 0.0 };
+
+    static double fraction(int matched, int compared) { return compared > 0 ? (double) matched / compared : 1.0; }
+};
+
+OfflineComparison compareResults(const OfflineAnalysisResult& reference, const OfflineAnalysisResult& other,
+                                 double timeToleranceSec, double bpmTolerance);
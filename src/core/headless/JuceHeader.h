@@ -0,0 +1,14 @@
+#pragma once
+
+// Stands in for the generated JuceHeader.h in targets built without juce_generate_juce_header
+// (master_tempo_core and the console tools): just the modules the analysis pipeline uses.
+#include <juce_core/juce_core.h>
+#include <juce_events/juce_events.h>
+#include <juce_audio_basics/juce_audio_basics.h>
+#include <juce_audio_formats/juce_audio_formats.h>
+#include <juce_dsp/juce_dsp.h>
+#include <juce_osc/juce_osc.h>
+
+#if ! DONT_SET_USING_JUCE_NAMESPACE
+ using namespace juce;
+#endif
@@ -0,0 +1,284 @@
+#include "AnalysisPipeline.h"
+
+// Wall clock in Unix seconds for a reading of the high-resolution monotonic counter (in
+// seconds), anchored once to the system clock
+static double toWallClockSec (double monotonicSec)
+{
+    static const double anchor = (double) juce::Time::currentTimeMillis() * 0.001
+                                 - juce::Time::getMillisecondCounterHiRes() * 0.001;
+    return monotonicSec + anchor;
+}
+
+// Raw OSC/NTP timetag: seconds since 1900 in the upper 32 bits, binary fraction below
+static juce::OSCTimeTag toOscTimeTag (double unixSec)
+{
+    const double ntpSec = unixSec + 2208988800.0;
+    const double whole = std::floor (ntpSec);
+    const auto fraction = (juce::uint64) juce::jlimit (0.0, 4294967295.0, (ntpSec - whole) * 4294967296.0);
+    return juce::OSCTimeTag ((((juce::uint64) whole) << 32) | fraction);
+}
+
+void AnalysisPipeline::analysisLoop()
+{
+    double nextTickMs = juce::Time::getMillisecondCounterHiRes();
+    while (analysisRunning.load())
+    {
+        {
+            std::lock_guard<RealtimeSafety::CheckedMutex> lock(analysisMutex);
+            analysisTick();
+        }
+        // Fixed-rate schedule; if a tick overran, start the next one right away
+        const double periodMs = 1000.0 / (double) juce::jlimit(1, 1000, analysisRateHz.load());
+        nextTickMs = juce::jmax(nextTickMs + periodMs, juce::Time::getMillisecondCounterHiRes());
+        const double waitMs = nextTickMs - juce::Time::getMillisecondCounterHiRes();
+        if (waitMs >= 1.0)
+            analysisWake.wait(waitMs);
+    }
+}
+
+// Runs on the analysis thread with analysisMutex held: drains the detectors, fuses per-band
+// flux, merges and gates onsets, drives tempo/beat tracking, sends OSC/MIDI and publishes
+// the snapshot
+void AnalysisPipeline::analysisTick()
+{
+    if (tempoWorker && beatTracker)
+    {
+        OnsetFusion::BandFlux bandFluxFrames;
+        {
+            std::lock_guard<RealtimeSafety::CheckedMutex> lock(bandMutex);
+            for (size_t i = 0; i < bandOnsetsHi.size(); ++i)
+                if (bandOnsetsHi[i])
+                    bandOnsetsHi[i]->fetchNewFlux(bandFluxFrames[i]);
+        }
+
+        std::vector<float> fusedFlux;
+        {
+            StageProfiler::ScopedTimer timer(profiler, StageProfiler::FluxFusion);
+            fusion.fuseFlux(bandFluxFrames, fusedFlux);
+        }
+        if (!fusedFlux.empty())
+            tempoWorker->pushFlux(fusedFlux.data(), fusedFlux.size());
+
+        OnsetFusion::BandOnsets cachedBandOnsets;
+        std::vector<double> mergedOnsets;
+        {
+            std::lock_guard<RealtimeSafety::CheckedMutex> lock(bandMutex);
+            for (size_t i = 0; i < bandOnsetsHi.size(); ++i)
+            {
+                if (bandOnsetsHi[i])
+                {
+                    bandOnsetsHi[i]->fetchOnsets(cachedBandOnsets[i]);
+                    if (!cachedBandOnsets[i].empty())
+                        std::sort(cachedBandOnsets[i].begin(), cachedBandOnsets[i].end());
+                    mergedOnsets.insert(mergedOnsets.end(), cachedBandOnsets[i].begin(), cachedBandOnsets[i].end());
+                }
+                if (bandOnsetsLo[i])
+                {
+                    std::vector<double> tmp;
+                    bandOnsetsLo[i]->fetchOnsets(tmp);
+                    if (!tmp.empty())
+                        std::sort(tmp.begin(), tmp.end());
+                    mergedOnsets.insert(mergedOnsets.end(), tmp.begin(), tmp.end());
+                }
+            }
+        }
+        if (!mergedOnsets.empty())
+        {
+            {
+                StageProfiler::ScopedTimer timer(profiler, StageProfiler::OnsetGating);
+                fusion.gateOnsets(cachedBandOnsets, mergedOnsets, tempoWorker->getSnapshot().bpm);
+            }
+            tempoWorker->pushOnsets(mergedOnsets.data(), mergedOnsets.size());
+            beatTracker->onOnsets(mergedOnsets);
+            if (oscConnected)
+            {
+                StageProfiler::ScopedTimer timer(profiler, StageProfiler::OscSend);
+                const bool legacy = sendLegacyBeatOnsets.load();
+                for (auto t : mergedOnsets)
+                {
+                    osc.send (onsetAddress, (float) t);
+                    if (legacy)
+                        osc.send (beatAddress, (float) t); // deprecated: /beat t before /onset
+                }
+            }
+            if (events.onset)
+                for (auto t : mergedOnsets)
+                    events.onset (t);
+            std::lock_guard<RealtimeSafety::CheckedMutex> midiLock(midiMutex);
+            if (midiSender)
+            {
+                juce::MidiBuffer buffer;
+                const int vel = 100;
+                for (size_t i = 0; i < mergedOnsets.size(); ++i)
+                {
+                    buffer.addEvent (juce::MidiMessage::noteOn  (midiChannel, midiBeatNote, (juce::uint8) vel), 0);
+                    buffer.addEvent (juce::MidiMessage::noteOff (midiChannel, midiBeatNote), 60);
+                }
+                StageProfiler::ScopedTimer timer(profiler, StageProfiler::MidiSend);
+                midiSender (buffer);
+            }
+        }
+
+        if (mode == Mode::Offline)
+            tempoWorker->processPending();
+        const double timeSecNow = getStreamTimeSec();
+        const TempoSnapshot tempo = tempoWorker->getSnapshot();
+        const double bpm = tempo.bpm;
+        const double conf = tempo.confidence;
+
+        // Hysteresis counts fresh estimates, so it does not depend on the analysis rate
+        const bool newEstimate = tempo.version != lastTempoVersion;
+        lastTempoVersion = tempo.version;
+        if (newEstimate && tempoHysteresis.onEstimate(bpm, conf))
+        {
+            beatTracker->updateBpm(bpm);
+            const double period = 60.0 / bpm;
+            const double refr = juce::jlimit(0.04, 0.18, 0.20 * period);
+            {
+                std::lock_guard<RealtimeSafety::CheckedMutex> lock(bandMutex);
+                for (size_t b = 0; b < 5; ++b)
+                {
+                    if (bandOnsetsHi[b]) bandOnsetsHi[b]->setRefractorySeconds(refr);
+                    if (bandOnsetsLo[b]) bandOnsetsLo[b]->setRefractorySeconds(refr);
+                }
+            }
+        }
+
+        if (oscConnected && newEstimate)
+        {
+            StageProfiler::ScopedTimer timer(profiler, StageProfiler::OscSend);
+            osc.send (tempoAddress, (float) bpm, (float) conf);
+            if (sendTempoCandidates.load())
+                for (int i = 0; i < tempo.numCandidates; ++i)
+                    osc.send (candidateAddress, i, (float) tempo.candidates[(size_t) i].bpm, (float) tempo.candidates[(size_t) i].score);
+        }
+        if (events.tempo && newEstimate)
+            events.tempo (timeSecNow, bpm, conf);
+
+        if (newEstimate)
+        {
+            std::lock_guard<RealtimeSafety::CheckedMutex> midiLock(midiMutex);
+            if (midiSender)
+            {
+                const double norm = juce::jlimit (60.0, 240.0, bpm);
+                const int value = juce::roundToInt ((norm - 60.0) * (127.0 / 180.0));
+                const int scaled = juce::jlimit<int> (0, 127, value);
+                juce::MidiBuffer buffer;
+                buffer.addEvent (juce::MidiMessage::controllerEvent (midiChannel, midiCcForTempo, scaled), 0);
+                StageProfiler::ScopedTimer timer(profiler, StageProfiler::MidiSend);
+                midiSender (buffer);
+            }
+        }
+
+        if (mode == Mode::Live)
+            sendScheduledBeats (timeSecNow);
+        if (events.onsetBatch && ! mergedOnsets.empty())
+            events.onsetBatch (timeSecNow, (int) mergedOnsets.size());
+        if (events.beat)
+            emitBeats (timeSecNow);
+
+        Snapshot snap;
+        snap.bpm = bpm;
+        snap.confidence = conf;
+        snap.streamTimeSec = timeSecNow;
+        snap.nextBeatSec = beatTracker->getNextBeatTimeSec(timeSecNow);
+        if (beatTracker->hasPhaseLock())
+        {
+            const double cycles = (timeSecNow - beatTracker->getPhaseOriginSec()) / beatTracker->getPeriodSec();
+            snap.beatPhase = cycles - std::floor(cycles);
+        }
+        fusion.decay(timeSecNow);
+        for (size_t b = 0; b < snap.bandActivity.size(); ++b)
+            snap.bandActivity[b] = fusion.getBandActivity(b);
+        snapshot.publish(snap);
+    }
+
+    if (RealtimeSafety::isEnabled())
+    {
+        // The counters are process-wide; whichever stream sees a change first reports it
+        static std::atomic<uint64_t> lastReportedRtViolations { 0 };
+        const uint64_t allocations = RealtimeSafety::getAllocationViolations();
+        const uint64_t locks = RealtimeSafety::getLockViolations();
+        uint64_t reported = lastReportedRtViolations.load();
+        if (allocations + locks != reported && lastReportedRtViolations.compare_exchange_strong(reported, allocations + locks))
+        {
+            const char* scope = RealtimeSafety::getLastViolationScope();
+            juce::Logger::writeToLog ("RT safety: " + juce::String ((juce::int64) allocations) + " allocations, "
+                                      + juce::String ((juce::int64) locks) + " lock acquisitions on real-time threads (last in "
+                                      + juce::String (scope != nullptr ? scope : "?") + ")");
+        }
+    }
+
+    const double nowMs = juce::Time::getMillisecondCounterHiRes();
+    if (nowMs - lastStatsSentMs >= statsIntervalMs)
+    {
+        lastStatsSentMs = nowMs;
+        sendCaptureStats();
+        sendStageStats();
+    }
+}
+
+// Passes each beat of the tracker's grid to events.beat once stream time has reached it,
+// starting from when the tracker first locks
+void AnalysisPipeline::emitBeats (double streamNowSec)
+{
+    beatCursor.advance (*beatTracker, streamNowSec, events.beat);
+}
+
+// Capture FIFO health, cumulative since start:
+//   /stats overruns underruns droppedSamples highWatermark capacity fill
+void AnalysisPipeline::sendCaptureStats()
+{
+    if (! oscConnected)
+        return;
+    const auto stats = captureFifo.getStats();
+    auto clampInt = [] (uint64_t v) { return (juce::int32) juce::jmin<uint64_t> (v, 0x7fffffff); };
+    osc.send (statsAddress, clampInt (stats.overruns), clampInt (stats.underruns), clampInt (stats.samplesDropped),
+              (juce::int32) stats.highWatermark, (juce::int32) stats.capacity, (juce::int32) stats.fill);
+}
+
+// Per-stage timing over the last stats interval, one message per stage that ran in it:
+//   /stats/stage name count mean_us p50_us p99_us max_us load_%
+void AnalysisPipeline::sendStageStats()
+{
+    if (! oscConnected)
+        return;
+    for (const auto& s : profiler.getIntervalSummaries())
+        if (s.count > 0)
+            osc.send (stageStatsAddress, juce::String (StageProfiler::getStageName (s.stage)),
+                      (juce::int32) juce::jmin<uint64_t> (s.count, 0x7fffffff), (float) s.meanUs, (float) s.p50Us,
+                      (float) s.p99Us, (float) s.maxUs, (float) s.loadPercent);
+}
+
+// Announces predicted beats ahead of time as OSC bundles timetagged with the beat's wall-clock
+// time, so receivers can fire them precisely instead of at timer resolution:
+//   bundle(t) { /beat id bpm revision } - new beat (revision 0), or a revised time for an already
+//                                          announced id (revision counts up; the highest wins)
+//   /beat/cancel id                      - an announced beat is no longer expected
+void AnalysisPipeline::sendScheduledBeats (double streamNowSec)
+{
+    // Clock from the latest packet's own timestamp, not from this tick's time: the tick runs
+    // late by a varying amount. A packet newer than streamNowSec (it raced this tick) or from
+    // before the last prepare() waits for the next tick.
+    const auto clock = packetClock.read();
+    if (clock.monotonicSec > 0.0 && clock.streamSec <= streamNowSec)
+        beatScheduler.updateClock (clock.streamSec, toWallClockSec (clock.monotonicSec));
+
+    beatScheduler.update (*beatTracker, streamNowSec, [this] (const BeatScheduler::Event& e)
+    {
+        if (! oscConnected)
+            return;
+
+        StageProfiler::ScopedTimer timer (profiler, StageProfiler::OscSend);
+        if (e.type == BeatScheduler::Event::Type::Cancel)
+        {
+            osc.send (beatCancelAddress, (juce::int32) e.id);
+            return;
+        }
+
+        juce::OSCBundle bundle (toOscTimeTag (e.wallTimeSec));
+        bundle.addElement (juce::OSCMessage (beatAddress, (juce::int32) e.id, (float) e.bpm, (juce::int32) e.revision));
+        osc.send (bundle);
+    });
+}
+
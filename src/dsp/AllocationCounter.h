@@ -0,0 +1,151 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <mutex>
+
+// Debug-only count of heap allocations per thread. With MASTER_TEMPO_COUNT_ALLOCATIONS=1 the
+// global operator new is replaced (allocation_counter.cpp) and bumps a thread-local counter;
+// otherwise every count reads zero and the checks below compile to nothing useful.
+namespace AllocationCounter
+{
+    inline thread_local uint64_t threadAllocations = 0;
+
+    inline uint64_t getThreadCount() noexcept { return threadAllocations; }
+
+    constexpr bool isEnabled() noexcept
+    {
+       #if MASTER_TEMPO_COUNT_ALLOCATIONS
+        return true;
+       #else
+        return false;
+       #endif
+    }
+
+    // Adds the allocations made on this thread during its lifetime to a running tally and,
+    // when armed, asserts that there were none.
+    class ScopedTally {
+    public:
+        ScopedTally(uint64_t& tallyToUpdate, bool expectNone) noexcept
+            : tally(tallyToUpdate), armed(expectNone), start(getThreadCount()) {}
+
+        ~ScopedTally()
+        {
+            const uint64_t made = getThreadCount() - start;
+            tally += made;
+            jassert(!armed || made == 0);
+            juce::ignoreUnused(armed);
+        }
+
+    private:
+        uint64_t& tally;
+        bool armed;
+        uint64_t start;
+    };
+}
+
+// Opt-in real-time safety checks (MASTER_TEMPO_RT_SAFETY_CHECKS=1, which also installs the
+// counting operator new). Real-time code marks its steady state with ScopedRealtime; a heap
+// allocation or a CheckedMutex acquisition on a thread inside such a scope is a violation.
+// Report mode counts violations (and remembers the offending scope's name) for a non-real-time
+// thread to log; Abort mode terminates on the spot so a debugger lands on the culprit.
+// Without the build flag the scopes are empty and CheckedMutex is a plain std::mutex.
+namespace RealtimeSafety
+{
+    enum class Mode { Off, Report, Abort };
+    enum class Violation { Allocation, Lock };
+
+    constexpr bool isEnabled() noexcept
+    {
+       #if MASTER_TEMPO_RT_SAFETY_CHECKS
+        return true;
+       #else
+        return false;
+       #endif
+    }
+
+    inline thread_local int realtimeDepth = 0;
+    inline thread_local const char* realtimeName = nullptr;
+    inline std::atomic<int> mode { (int) Mode::Report };
+    inline std::atomic<uint64_t> allocationViolations { 0 };
+    inline std::atomic<uint64_t> lockViolations { 0 };
+    inline std::atomic<const char*> lastViolationScope { nullptr };
+
+    inline void setMode(Mode m) noexcept { mode.store((int) m, std::memory_order_relaxed); }
+    inline Mode getMode() noexcept       { return (Mode) mode.load(std::memory_order_relaxed); }
+
+    inline bool isRealtimeThread() noexcept { return isEnabled() && realtimeDepth > 0; }
+
+    inline uint64_t getAllocationViolations() noexcept { return allocationViolations.load(std::memory_order_relaxed); }
+    inline uint64_t getLockViolations() noexcept       { return lockViolations.load(std::memory_order_relaxed); }
+    inline const char* getLastViolationScope() noexcept { return lastViolationScope.load(std::memory_order_relaxed); }
+
+    // Must not allocate or lock: it runs inside operator new
+    inline void reportViolation(Violation v) noexcept
+    {
+        const Mode m = getMode();
+        if (m == Mode::Off) return;
+        (v == Violation::Allocation ? allocationViolations : lockViolations).fetch_add(1, std::memory_order_relaxed);
+        lastViolationScope.store(realtimeName, std::memory_order_relaxed);
+        if (m == Mode::Abort)
+            std::abort();
+    }
+
+    // Marks the calling thread as real-time for the scope's lifetime (nests). Pass armed = false
+    // during warm-up so the first blocks after (re)configuration may still allocate.
+    class ScopedRealtime {
+    public:
+        explicit ScopedRealtime(const char* name, bool armed = true) noexcept
+            : active(isEnabled() && armed)
+        {
+            if (!active) return;
+            previousName = realtimeName;
+            realtimeName = name;
+            ++realtimeDepth;
+        }
+
+        ~ScopedRealtime()
+        {
+            if (!active) return;
+            --realtimeDepth;
+            realtimeName = previousName;
+        }
+
+    private:
+        bool active;
+        const char* previousName { nullptr };
+    };
+
+    // Lifts the real-time mark for work that may legitimately block (reconfiguration)
+    class ScopedNonRealtime {
+    public:
+        ScopedNonRealtime() noexcept : savedDepth(realtimeDepth) { realtimeDepth = 0; }
+        ~ScopedNonRealtime() { realtimeDepth = savedDepth; }
+
+    private:
+        int savedDepth;
+    };
+
+    // std::mutex that reports being locked from a real-time scope. Works with std::lock_guard.
+    class CheckedMutex {
+    public:
+        void lock()
+        {
+            if (isRealtimeThread()) reportViolation(Violation::Lock);
+            mutex.lock();
+        }
+
+        bool try_lock()
+        {
+            if (isRealtimeThread()) reportViolation(Violation::Lock);
+            return mutex.try_lock();
+        }
+
+        void unlock() { mutex.unlock(); }
+
+    private:
+        std::mutex mutex;
+    };
+}
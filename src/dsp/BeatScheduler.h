@@ -0,0 +1,191 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "BeatTracker.h"
+#include <array>
+#include <cstdint>
+#include <cmath>
+
+// Predicts upcoming beats from the tracker's period and phase and keeps a short list of beats
+// that have been announced ahead of time. Each update compares the fresh prediction with that
+// list and emits what a consumer must send:
+//   Schedule - a newly predicted beat (new id)
+//   Revise   - an announced beat moved by more than the revise threshold (same id, new time,
+//              next revision number)
+//   Cancel   - an announced beat no longer predicted (tempo or phase jump, or lost lock)
+// Beat times are on the stream clock (captured samples / sample rate); the scheduler also keeps
+// a smoothed stream -> wall clock offset so events carry absolute wall-clock times.
+class BeatScheduler {
+public:
+    struct Event
+    {
+        enum class Type { Schedule, Revise, Cancel };
+        Type type;
+        uint32_t id;
+        uint32_t revision;    // 0 when scheduled, one more on each Revise of the same id
+        double streamTimeSec; // beat time on the stream clock
+        double wallTimeSec;   // same instant on the wall clock, including the output offset
+        double bpm;
+    };
+
+    static constexpr int maxPending = 16;
+
+    // Announce beats up to lookAheadSec ahead, at most maxBeats at a time
+    void setLookAhead(double lookAheadSec, int maxBeats)
+    {
+        lookAhead = juce::jlimit(0.1, 8.0, lookAheadSec);
+        maxAhead = juce::jlimit(1, maxPending, maxBeats);
+    }
+
+    // Announced beats closer than this to playback are left alone: the receiver has them
+    void setFreezeSec(double seconds)         { freezeSec = juce::jlimit(0.0, 0.5, seconds); }
+    void setReviseThresholdSec(double seconds) { reviseThresholdSec = juce::jlimit(0.0001, 0.05, seconds); }
+    // Shift applied to wall times, e.g. negative to compensate for lamp/DMX latency
+    void setOutputOffsetSec(double seconds)    { outputOffsetSec = seconds; }
+
+    // Forget announced beats and the clock mapping (new stream, sample-rate change)
+    void reset()
+    {
+        numPending = 0;
+        hasClock = false;
+    }
+
+    // A stream time and the wall time of the same instant, e.g. a capture packet's end sample
+    // and its device timestamp. Single readings jitter with the timestamps; a slow average
+    // removes that without following real drift too late. A jump of over 250 ms restarts it.
+    void updateClock(double streamSec, double wallSec)
+    {
+        const double offset = wallSec - streamSec;
+        if (!hasClock || std::abs(offset - clockOffsetSec) > 0.25)
+        {
+            clockOffsetSec = offset;
+            hasClock = true;
+        }
+        else
+        {
+            clockOffsetSec += 0.02 * (offset - clockOffsetSec);
+        }
+    }
+
+    // Wall times use the clock from updateClock; call that at least once first
+    template <typename EmitFn>
+    void update(const BeatTracker& tracker, double streamNowSec, EmitFn&& emit)
+    {
+        if (!hasClock) return;
+
+        // Beats that have played are done
+        int kept = 0;
+        for (int i = 0; i < numPending; ++i)
+            if (pending[(size_t) i].streamTimeSec > streamNowSec)
+                pending[(size_t) kept++] = pending[(size_t) i];
+        numPending = kept;
+
+        const double period = tracker.getPeriodSec();
+        if (!tracker.hasPhaseLock() || period <= 0.0)
+        {
+            cancelWhere(emit, [&](const Pending& p) { return p.streamTimeSec > streamNowSec + freezeSec; });
+            return;
+        }
+        const double bpm = 60.0 / period;
+
+        // Fresh prediction
+        std::array<double, maxPending> predicted {};
+        int numPredicted = 0;
+        const double first = tracker.getNextBeatTimeSec(streamNowSec);
+        for (int i = 0; i < maxAhead; ++i)
+        {
+            const double t = first + (double) i * period;
+            if (t > streamNowSec + lookAhead) break;
+            predicted[(size_t) numPredicted++] = t;
+        }
+
+        // Pair each announced beat with the nearest prediction within half a period
+        std::array<bool, maxPending> predictionUsed {};
+        std::array<bool, maxPending> pendingMatched {};
+        for (int i = 0; i < numPending; ++i)
+        {
+            int best = -1;
+            double bestDist = 0.5 * period;
+            for (int j = 0; j < numPredicted; ++j)
+            {
+                const double d = std::abs(predicted[(size_t) j] - pending[(size_t) i].streamTimeSec);
+                if (!predictionUsed[(size_t) j] && d < bestDist)
+                {
+                    best = j;
+                    bestDist = d;
+                }
+            }
+            if (best < 0) continue;
+            predictionUsed[(size_t) best] = true;
+            pendingMatched[(size_t) i] = true;
+
+            auto& p = pending[(size_t) i];
+            const bool frozen = p.streamTimeSec <= streamNowSec + freezeSec;
+            if (!frozen && bestDist > reviseThresholdSec && predicted[(size_t) best] > streamNowSec + freezeSec)
+            {
+                p.streamTimeSec = predicted[(size_t) best];
+                ++p.revision;
+                emit(makeEvent(Event::Type::Revise, p, bpm));
+            }
+        }
+
+        // Announced beats without a counterpart were predicted wrongly
+        int idx = 0;
+        cancelWhere(emit, [&](const Pending& p)
+        {
+            const bool unmatched = !pendingMatched[(size_t) idx++];
+            return unmatched && p.streamTimeSec > streamNowSec + freezeSec;
+        });
+
+        // New beats
+        for (int j = 0; j < numPredicted && numPending < maxPending; ++j)
+        {
+            if (predictionUsed[(size_t) j]) continue;
+            if (predicted[(size_t) j] <= streamNowSec + freezeSec) continue; // too late to announce
+            auto& p = pending[(size_t) numPending++];
+            p.id = nextId++;
+            p.revision = 0;
+            p.streamTimeSec = predicted[(size_t) j];
+            emit(makeEvent(Event::Type::Schedule, p, bpm));
+        }
+    }
+
+    double toWallTime(double streamTimeSec) const { return streamTimeSec + clockOffsetSec + outputOffsetSec; }
+
+private:
+    struct Pending { uint32_t id; uint32_t revision; double streamTimeSec; };
+
+    Event makeEvent(Event::Type type, const Pending& p, double bpm) const
+    {
+        return Event { type, p.id, p.revision, p.streamTimeSec, toWallTime(p.streamTimeSec), bpm };
+    }
+
+    // Emits Cancel for and removes every announced beat matching the predicate (in order)
+    template <typename EmitFn, typename Pred>
+    void cancelWhere(EmitFn& emit, Pred&& shouldCancel)
+    {
+        int kept = 0;
+        for (int i = 0; i < numPending; ++i)
+        {
+            const auto p = pending[(size_t) i];
+            if (shouldCancel(p))
+                emit(makeEvent(Event::Type::Cancel, p, 0.0));
+            else
+                pending[(size_t) kept++] = p;
+        }
+        numPending = kept;
+    }
+
+    std::array<Pending, maxPending> pending {};
+    int numPending { 0 };
+    uint32_t nextId { 1 };
+
+    double lookAhead { 2.0 };
+    int maxAhead { 4 };
+    double freezeSec { 0.010 };
+    double reviseThresholdSec { 0.0005 };
+    double outputOffsetSec { 0.0 };
+
+    double clockOffsetSec { 0.0 };
+    bool hasClock { false };
+};
@@ -56,6 +56,11 @@ public:
         return phaseOriginSec + n * periodSec;
     }
 
+    // Current beat grid: beats fall at getPhaseOriginSec() + n * getPeriodSec()
+    double getPeriodSec() const { return periodSec; }
+    double getPhaseOriginSec() const { return phaseOriginSec; }
+    bool hasPhaseLock() const { return hasPhase && periodSec > 0.0; }
+
     void freezePhase() { /* placeholder for future hysteresis hooks */ }
 
 private:
@@ -65,5 +70,64 @@ private:
     bool hasPhase { false };
 };
 
+// Walks a tracker's beat grid as stream time advances and hands out each beat once, starting
+// from the first advance() after the tracker locks. The grid may move between calls; a beat is
+// not repeated unless it moved by more than a quarter period.
+class BeatGridCursor {
+public:
+    // onBeat(double timeSec, double bpm) for every grid beat in (last advance, nowSec]
+    template <typename Fn>
+    void advance(const BeatTracker& tracker, double nowSec, Fn&& onBeat)
+    {
+        if (!tracker.hasPhaseLock()) return;
+        if (cursorSec < 0.0)
+            cursorSec = nowSec;
+        const double period = tracker.getPeriodSec();
+        for (double next = tracker.getNextBeatTimeSec(cursorSec); next <= nowSec; next = tracker.getNextBeatTimeSec(cursorSec))
+        {
+            onBeat(next, 60.0 / period);
+            cursorSec = next + 0.25 * period;
+        }
+    }
+
+    void reset() noexcept { cursorSec = -1.0; }
+
+private:
+    double cursorSec { -1.0 };
+};
+
+// Decides which tempo estimates reach the tracker. Confident estimates within 4% of the last
+// applied tempo count as stable, anything else restarts the count; every third stable one
+// is applied.
+class TempoHysteresis {
+public:
+    // One call per fresh estimate; true if bpm should go to the tracker
+    bool onEstimate(double bpm, double confidence)
+    {
+        if (confidence < minConfidence) return false;
+        const double rel = (lastAppliedBpm > 0.0 && bpm > 0.0) ? std::abs(bpm - lastAppliedBpm) / juce::jmax(1.0, lastAppliedBpm) : 0.0;
+        if (rel < 0.04)
+            ++stableEstimates;
+        else
+            stableEstimates = 0;
+
+        if (stableEstimates < 3 || bpm <= 0.0) return false;
+        lastAppliedBpm = bpm;
+        stableEstimates = 0;
+        return true;
+    }
+
+    void reset() noexcept
+    {
+        stableEstimates = 0;
+        lastAppliedBpm = -1.0;
+    }
+
+private:
+    static constexpr double minConfidence = 0.25;
+    int stableEstimates { 0 };
+    double lastAppliedBpm { -1.0 };
+};
+
 
 
@@ -0,0 +1,480 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <utility>
+#include "SimdLanes.h"
+
+// Up to eight biquad sections (lanes) with SoA state, advanced together in one SIMD pass.
+//   Parallel: every lane filters the same input, optionally through a cascade of up to
+//             maxStages sections per lane (e.g. HP then LP), and writes its own output:
+//             one pass splits the signal into up to eight bands. Stage s works on stage s-1's
+//             output from the previous sample, so the stages are independent within a sample;
+//             outputs are delayed by getLatencySamples() = numStages - 1 samples. Eight samples
+//             of all lanes are transposed in registers and stored straight to the outputs
+//             (on SSE2: four lanes per register, a fifth lane's cascade in one register).
+//   Series:   the lanes form one chain (lane 0 first). Lane i works on lane i-1's output from
+//             the previous sample, so all sections run in the same pass; the output is delayed
+//             by getLatencySamples() = numLanes - 1 samples.
+// Sections are transposed direct form II. setSection may be called from any thread: it only
+// stores the target in atomics. The processing thread picks targets up at the next block and
+// glides frequency (log scale) and Q there over the smoothing time, recomputing coefficients
+// every smoothingBlock samples while moving. A change of filter type is applied at once.
+// prepare/reset must not run concurrently with processing.
+class BiquadFilterBank {
+public:
+    enum class Topology { Parallel, Series };
+    enum class Type { Identity, LowPass, HighPass, BandPass };
+
+    static constexpr int maxLanes = 8;
+    static constexpr int maxStages = 4;
+    static constexpr int smoothingBlock = 32;
+
+    BiquadFilterBank(Topology topology, int numLanes, int numStages = 1)
+        : topology(topology),
+          numLanes(juce::jlimit(1, maxLanes, numLanes)),
+          numStages(topology == Topology::Series ? 1 : juce::jlimit(1, maxStages, numStages))
+    {
+        jassert(numLanes >= 1 && numLanes <= maxLanes);
+        for (int s = 0; s < maxStages; ++s)
+            for (int l = 0; l < maxLanes; ++l)
+                setIdentity(s, l);
+    }
+
+    // Thread-safe target update; q defaults to Butterworth
+    void setSection(int lane, Type type, float frequencyHz, float q = 0.70710678f, int stage = 0)
+    {
+        jassert(lane >= 0 && lane < numLanes && stage >= 0 && stage < numStages);
+        auto& p = params[(size_t) stage][(size_t) lane];
+        p.type.store((int) type, std::memory_order_relaxed);
+        p.frequency.store(frequencyHz, std::memory_order_relaxed);
+        p.q.store(q, std::memory_order_relaxed);
+        paramsVersion.fetch_add(1, std::memory_order_release);
+    }
+
+    void setSmoothingTimeSec(double seconds) { smoothingSec = juce::jmax(0.0, seconds); updateSmoothingCoefficient(); }
+
+    // Snaps coefficients to the current targets and clears the state
+    void prepare(double newSampleRate)
+    {
+        sampleRate = juce::jmax(1.0, newSampleRate);
+        updateSmoothingCoefficient();
+        seenVersion = paramsVersion.load(std::memory_order_acquire);
+        for (int s = 0; s < numStages; ++s)
+            for (int l = 0; l < numLanes; ++l)
+            {
+                auto& sm = smooth[(size_t) s][(size_t) l];
+                readTarget(s, l);
+                sm.logFrequency = sm.targetLogFrequency;
+                sm.q = sm.targetQ;
+                computeCoefficients(s, l);
+            }
+        moving = false;
+        reset();
+    }
+
+    void reset()
+    {
+        for (auto& st : state)
+        {
+            std::fill(std::begin(st.s1), std::end(st.s1), 0.0f);
+            std::fill(std::begin(st.s2), std::end(st.s2), 0.0f);
+        }
+        std::fill(std::begin(pipe), std::end(pipe), 0.0f);
+        for (auto& out : stageOut)
+            std::fill(std::begin(out), std::end(out), 0.0f);
+    }
+
+    int getNumLanes() const noexcept { return numLanes; }
+    int getLatencySamples() const noexcept { return topology == Topology::Series ? numLanes - 1 : numStages - 1; }
+
+    // Series topology, in place
+    void processSeries(float* data, int numSamples) noexcept
+    {
+        jassert(topology == Topology::Series);
+        juce::ScopedNoDenormals noDenormals;
+        using namespace SimdLanes;
+        pollTargets();
+
+        const auto& c = coeffs[0];
+        auto& st = state[0];
+        F8 y = load(pipe);
+        for (int start = 0; start < numSamples; start += smoothingBlock)
+        {
+            if (moving) advanceSmoothing();
+            const F8 b0 = load(c.b0), b1 = load(c.b1), b2 = load(c.b2), a1 = load(c.a1), a2 = load(c.a2);
+            F8 s1 = load(st.s1), s2 = load(st.s2);
+            const int end = juce::jmin(numSamples, start + smoothingBlock);
+            const int last = numLanes - 1;
+            for (int i = start; i < end; ++i)
+            {
+                const F8 x = shiftIn(y, data[i]);
+                y = add(mul(b0, x), s1);
+                s1 = sub(add(mul(b1, x), s2), mul(a1, y)); // b1 x + s2 off the y -> y chain
+                s2 = sub(mul(b2, x), mul(a2, y));
+                store(pipe, y);
+                data[i] = pipe[last];
+            }
+            store(st.s1, s1);
+            store(st.s2, s2);
+        }
+    }
+
+    // Parallel topology: outputs[lane] receives lane's band for each of the first numLanes lanes
+    void processParallel(const float* input, float* const* outputs, int numSamples) noexcept
+    {
+        jassert(topology == Topology::Parallel);
+        juce::ScopedNoDenormals noDenormals;
+        using namespace SimdLanes;
+        pollTargets();
+
+        for (int start = 0; start < numSamples; start += smoothingBlock)
+        {
+            if (moving) advanceSmoothing();
+            const int end = juce::jmin(numSamples, start + smoothingBlock);
+            switch (numStages)
+            {
+                case 1:  runParallelStages<1>(input, outputs, start, end); break;
+                case 2:  runParallelStages<2>(input, outputs, start, end); break;
+                case 3:  runParallelStages<3>(input, outputs, start, end); break;
+                default: runParallelStages<4>(input, outputs, start, end); break;
+            }
+        }
+    }
+
+private:
+    struct SectionParams
+    {
+        std::atomic<int> type { (int) Type::Identity };
+        std::atomic<float> frequency { 1000.0f };
+        std::atomic<float> q { 0.70710678f };
+    };
+
+    struct Smoothing
+    {
+        Type type { Type::Identity };
+        float logFrequency { 0.0f }, targetLogFrequency { 0.0f };
+        float q { 0.70710678f }, targetQ { 0.70710678f };
+    };
+
+    struct alignas(32) StageCoefficients { float b0[maxLanes], b1[maxLanes], b2[maxLanes], a1[maxLanes], a2[maxLanes]; };
+    struct alignas(32) StageState { float s1[maxLanes] {}, s2[maxLanes] {}; };
+
+    // fn(std::integral_constant<int, s>) for s = Stages - 1 down to 0, unrolled at compile time so
+    // the per-stage arrays are indexed by constants and can live in registers
+    template <int Stages, typename Fn, int... S>
+    static void forEachStageDescending(Fn&& fn, std::integer_sequence<int, S...>) noexcept
+    {
+        (fn(std::integral_constant<int, Stages - 1 - S>()), ...);
+    }
+
+    // Stages == numStages: the coefficients, state and stage outputs stay in registers for the
+    // whole block. In Parallel every stage is identity by default.
+    template <int Stages>
+    void runParallelStages(const float* input, float* const* outputs, int start, int end) noexcept
+    {
+        static_assert(Stages >= 1 && Stages <= maxStages, "stage count out of range");
+       #if MASTER_TEMPO_LANES_SSE2
+        // Sixteen registers cannot hold several stages of eight lanes (two registers each), so
+        // lanes go in groups of four, one register per stage. A fifth lane rides along as a
+        // chain (see runParallelQuad) rather than in registers of three idle lanes each.
+        if (numLanes == 1)
+            runParallelQuad<Stages, false, true>(0, input, outputs, start, end);
+        else if (numLanes == 5)
+            runParallelQuad<Stages, true, true>(0, input, outputs, start, end);
+        else
+            for (int first = 0; first < numLanes; first += 4)
+                runParallelQuad<Stages, true, false>(first, input, outputs, start, end);
+       #else
+        using namespace SimdLanes;
+        constexpr int stages = Stages;
+        F8 b0[Stages] {}, b1[Stages] {}, b2[Stages] {}, a1[Stages] {}, a2[Stages] {}, s1[Stages] {}, s2[Stages] {}, y[Stages] {};
+        for (int s = 0; s < stages; ++s)
+        {
+            const auto& c = coeffs[(size_t) s];
+            b0[s] = load(c.b0); b1[s] = load(c.b1); b2[s] = load(c.b2); a1[s] = load(c.a1); a2[s] = load(c.a2);
+            s1[s] = load(state[(size_t) s].s1); s2[s] = load(state[(size_t) s].s2);
+            y[s] = load(stageOut[(size_t) s]);
+        }
+        for (int i = start; i < end; i += 8)
+        {
+            // Eight samples of every lane, then one transpose into eight samples per lane
+            F8 rows[8];
+            const int count = juce::jmin(8, end - i);
+            for (int k = 0; k < count; ++k)
+            {
+                const F8 x = set1(input[i + k]);
+                forEachStageDescending<Stages>([&](auto stage)
+                {
+                    constexpr int s = decltype(stage)::value;
+                    F8 in = x;
+                    if constexpr (s > 0)
+                        in = y[s - 1]; // previous sample's output of the stage before
+                    y[s] = add(mul(b0[s], in), s1[s]);
+                    s1[s] = sub(add(mul(b1[s], in), s2[s]), mul(a1[s], y[s]));
+                    s2[s] = sub(mul(b2[s], in), mul(a2[s], y[s]));
+                }, std::make_integer_sequence<int, Stages>());
+                rows[k] = y[stages - 1];
+            }
+            for (int k = count; k < 8; ++k)
+                rows[k] = set1(0.0f);
+            transpose(rows);
+            if (count == 8)
+            {
+                for (int l = 0; l < numLanes; ++l)
+                    storeUnaligned(outputs[l] + i, rows[l]);
+            }
+            else
+            {
+                alignas(32) float lane[8];
+                for (int l = 0; l < numLanes; ++l)
+                {
+                    store(lane, rows[l]);
+                    std::copy(lane, lane + count, outputs[l] + i);
+                }
+            }
+        }
+        for (int s = 0; s < stages; ++s)
+        {
+            store(state[(size_t) s].s1, s1[s]);
+            store(state[(size_t) s].s2, s2[s]);
+            store(stageOut[(size_t) s], y[s]);
+        }
+       #endif
+    }
+
+   #if MASTER_TEMPO_LANES_SSE2
+    // Quad: lanes first..first+3 in one register (those below numLanes are stored), one register
+    // per stage, four samples per transpose. Chain: one more lane (first + 4 after a quad, else
+    // first) with its stages side by side in a single register: slot s is stage s, fed stage
+    // s-1's previous output as in the Series topology, so a lane of up to four sections costs
+    // one register instead of one per stage.
+    template <int Stages, bool Quad, bool Chain>
+    void runParallelQuad(int first, const float* input, float* const* outputs, int start, int end) noexcept
+    {
+        __m128 b0[Stages], b1[Stages], b2[Stages], a1[Stages], a2[Stages], s1[Stages], s2[Stages], y[Stages];
+        const int chained = Quad ? first + 4 : first;
+        alignas(16) float cc[7][4] {}; // chain lane: b0 b1 b2 a1 a2 s1 s2 per stage, unused slots zero
+        alignas(16) float cy[4] {};
+        for (int s = 0; s < Stages; ++s)
+        {
+            const auto& c = coeffs[(size_t) s];
+            const auto& st = state[(size_t) s];
+            if constexpr (Quad)
+            {
+                b0[s] = _mm_load_ps(c.b0 + first); b1[s] = _mm_load_ps(c.b1 + first); b2[s] = _mm_load_ps(c.b2 + first);
+                a1[s] = _mm_load_ps(c.a1 + first); a2[s] = _mm_load_ps(c.a2 + first);
+                s1[s] = _mm_load_ps(st.s1 + first); s2[s] = _mm_load_ps(st.s2 + first);
+                y[s] = _mm_load_ps(stageOut[(size_t) s] + first);
+            }
+            if constexpr (Chain)
+            {
+                cc[0][s] = c.b0[chained]; cc[1][s] = c.b1[chained]; cc[2][s] = c.b2[chained];
+                cc[3][s] = c.a1[chained]; cc[4][s] = c.a2[chained];
+                cc[5][s] = st.s1[chained]; cc[6][s] = st.s2[chained];
+                cy[s] = stageOut[(size_t) s][chained];
+            }
+        }
+        const __m128 cb0 = _mm_load_ps(cc[0]), cb1 = _mm_load_ps(cc[1]), cb2 = _mm_load_ps(cc[2]);
+        const __m128 ca1 = _mm_load_ps(cc[3]), ca2 = _mm_load_ps(cc[4]);
+        __m128 cs1 = _mm_load_ps(cc[5]), cs2 = _mm_load_ps(cc[6]), chainY = _mm_load_ps(cy);
+
+        const int lanes = juce::jmin(4, numLanes - first);
+        for (int i = start; i < end; i += 4)
+        {
+            __m128 rows[4];
+            const int count = juce::jmin(4, end - i);
+            for (int k = 0; k < count; ++k)
+            {
+                const __m128 x = _mm_set1_ps(input[i + k]);
+                if constexpr (Quad)
+                {
+                    forEachStageDescending<Stages>([&](auto stage)
+                    {
+                        constexpr int s = decltype(stage)::value;
+                        __m128 in = x;
+                        if constexpr (s > 0)
+                            in = y[s - 1]; // previous sample's output of the stage before
+                        y[s] = _mm_add_ps(_mm_mul_ps(b0[s], in), s1[s]);
+                        s1[s] = _mm_sub_ps(_mm_add_ps(_mm_mul_ps(b1[s], in), s2[s]), _mm_mul_ps(a1[s], y[s]));
+                        s2[s] = _mm_sub_ps(_mm_mul_ps(b2[s], in), _mm_mul_ps(a2[s], y[s]));
+                    }, std::make_integer_sequence<int, Stages>());
+                    rows[k] = y[Stages - 1];
+                }
+                if constexpr (Chain)
+                {
+                    // (x, y0, y1, y2): the input, then each stage's previous output one slot up
+                    const __m128 in = _mm_shuffle_ps(_mm_shuffle_ps(x, chainY, _MM_SHUFFLE(0, 0, 0, 0)), chainY, _MM_SHUFFLE(2, 1, 2, 0));
+                    chainY = _mm_add_ps(_mm_mul_ps(cb0, in), cs1);
+                    cs1 = _mm_sub_ps(_mm_add_ps(_mm_mul_ps(cb1, in), cs2), _mm_mul_ps(ca1, chainY));
+                    cs2 = _mm_sub_ps(_mm_mul_ps(cb2, in), _mm_mul_ps(ca2, chainY));
+                    _mm_store_ss(outputs[chained] + i + k, _mm_shuffle_ps(chainY, chainY, _MM_SHUFFLE(0, 0, 0, Stages - 1)));
+                }
+            }
+            if constexpr (Quad)
+            {
+                for (int k = count; k < 4; ++k)
+                    rows[k] = _mm_setzero_ps();
+                _MM_TRANSPOSE4_PS(rows[0], rows[1], rows[2], rows[3]);
+                if (count == 4)
+                {
+                    for (int l = 0; l < lanes; ++l)
+                        _mm_storeu_ps(outputs[first + l] + i, rows[l]);
+                }
+                else
+                {
+                    alignas(16) float lane[4];
+                    for (int l = 0; l < lanes; ++l)
+                    {
+                        _mm_store_ps(lane, rows[l]);
+                        std::copy(lane, lane + count, outputs[first + l] + i);
+                    }
+                }
+            }
+        }
+
+        _mm_store_ps(cc[5], cs1);
+        _mm_store_ps(cc[6], cs2);
+        _mm_store_ps(cy, chainY);
+        for (int s = 0; s < Stages; ++s)
+        {
+            auto& st = state[(size_t) s];
+            if constexpr (Quad)
+            {
+                _mm_store_ps(st.s1 + first, s1[s]);
+                _mm_store_ps(st.s2 + first, s2[s]);
+                _mm_store_ps(stageOut[(size_t) s] + first, y[s]);
+            }
+            if constexpr (Chain)
+            {
+                st.s1[chained] = cc[5][s];
+                st.s2[chained] = cc[6][s];
+                stageOut[(size_t) s][chained] = cy[s];
+            }
+        }
+    }
+   #endif
+
+    void setIdentity(int stage, int lane)
+    {
+        auto& c = coeffs[(size_t) stage];
+        c.b0[lane] = 1.0f;
+        c.b1[lane] = c.b2[lane] = c.a1[lane] = c.a2[lane] = 0.0f;
+    }
+
+    void readTarget(int stage, int lane)
+    {
+        const auto& p = params[(size_t) stage][(size_t) lane];
+        auto& sm = smooth[(size_t) stage][(size_t) lane];
+        const float nyquistGuard = (float) (0.49 * sampleRate);
+        sm.type = (Type) p.type.load(std::memory_order_relaxed);
+        sm.targetLogFrequency = std::log(juce::jlimit(1.0f, nyquistGuard, p.frequency.load(std::memory_order_relaxed)));
+        sm.targetQ = juce::jlimit(0.1f, 30.0f, p.q.load(std::memory_order_relaxed));
+    }
+
+    // New targets from setSection: start gliding towards them
+    void pollTargets() noexcept
+    {
+        const uint32_t version = paramsVersion.load(std::memory_order_acquire);
+        if (version == seenVersion) return;
+        seenVersion = version;
+        for (int s = 0; s < numStages; ++s)
+            for (int l = 0; l < numLanes; ++l)
+            {
+                auto& sm = smooth[(size_t) s][(size_t) l];
+                const Type previousType = sm.type;
+                readTarget(s, l);
+                if (sm.type != previousType)
+                {
+                    sm.logFrequency = sm.targetLogFrequency;
+                    sm.q = sm.targetQ;
+                    computeCoefficients(s, l);
+                }
+            }
+        moving = true;
+    }
+
+    void advanceSmoothing() noexcept
+    {
+        bool stillMoving = false;
+        for (int s = 0; s < numStages; ++s)
+            for (int l = 0; l < numLanes; ++l)
+            {
+                auto& sm = smooth[(size_t) s][(size_t) l];
+                const float df = sm.targetLogFrequency - sm.logFrequency;
+                const float dq = sm.targetQ - sm.q;
+                if (df == 0.0f && dq == 0.0f) continue;
+                if (std::abs(df) < 1.0e-4f && std::abs(dq) < 1.0e-4f)
+                {
+                    sm.logFrequency = sm.targetLogFrequency;
+                    sm.q = sm.targetQ;
+                }
+                else
+                {
+                    sm.logFrequency += smoothingAlpha * df;
+                    sm.q += smoothingAlpha * dq;
+                    stillMoving = true;
+                }
+                computeCoefficients(s, l);
+            }
+        moving = stillMoving;
+    }
+
+    // RBJ cookbook sections, normalised by a0
+    void computeCoefficients(int stage, int lane) noexcept
+    {
+        const auto& sm = smooth[(size_t) stage][(size_t) lane];
+        if (sm.type == Type::Identity)
+        {
+            setIdentity(stage, lane);
+            return;
+        }
+        const double w0 = juce::MathConstants<double>::twoPi * std::exp((double) sm.logFrequency) / sampleRate;
+        const double cosW = std::cos(w0);
+        const double alpha = std::sin(w0) / (2.0 * (double) sm.q);
+        double b0 = 0.0, b1 = 0.0, b2 = 0.0;
+        switch (sm.type)
+        {
+            case Type::LowPass:  b0 = 0.5 * (1.0 - cosW); b1 = 1.0 - cosW;    b2 = b0; break;
+            case Type::HighPass: b0 = 0.5 * (1.0 + cosW); b1 = -(1.0 + cosW); b2 = b0; break;
+            case Type::BandPass: b0 = alpha;              b1 = 0.0;           b2 = -alpha; break;
+            case Type::Identity: break;
+        }
+        const double invA0 = 1.0 / (1.0 + alpha);
+        auto& c = coeffs[(size_t) stage];
+        c.b0[lane] = (float) (b0 * invA0);
+        c.b1[lane] = (float) (b1 * invA0);
+        c.b2[lane] = (float) (b2 * invA0);
+        c.a1[lane] = (float) (-2.0 * cosW * invA0);
+        c.a2[lane] = (float) ((1.0 - alpha) * invA0);
+    }
+
+    void updateSmoothingCoefficient()
+    {
+        const double blocks = smoothingSec * sampleRate / (double) smoothingBlock;
+        smoothingAlpha = blocks > 1.0 ? (float) (1.0 - std::exp(-1.0 / blocks)) : 1.0f;
+    }
+
+    const Topology topology;
+    const int numLanes;
+    const int numStages;
+
+    double sampleRate { 48000.0 };
+    double smoothingSec { 0.02 };
+    float smoothingAlpha { 1.0f };
+    bool moving { false };
+
+    std::array<std::array<SectionParams, maxLanes>, maxStages> params;
+    std::atomic<uint32_t> paramsVersion { 0 };
+    uint32_t seenVersion { 0 };
+    std::array<std::array<Smoothing, maxLanes>, maxStages> smooth {};
+
+    std::array<StageCoefficients, maxStages> coeffs {};
+    std::array<StageState, maxStages> state {};
+    alignas(32) float pipe[maxLanes] {};                          // Series: last output of every lane
+    alignas(32) float stageOut[maxStages][maxLanes] {};           // Parallel: last output of every stage
+};
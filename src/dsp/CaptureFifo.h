@@ -0,0 +1,309 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+// Mono sample FIFO between the capture callback (single producer) and the DSP thread (single
+// consumer), with accounting for everything that goes wrong in between.
+//
+// Storage is allocated once, in the constructor; the usable capacity (the fill level at which
+// the FIFO counts as full) starts lower and, with auto-grow on, doubles on each overrun up to
+// maxCapacity. Growing only moves a limit, so it is safe while both threads run.
+//
+// When a write does not fit:
+//  - DropOldest: the writer first moves the read index past the oldest samples, then writes, so
+//    the newest audio is always kept and analysis resumes on it. The reader checks after each
+//    copy that the read index did not move under it and reads again if it did.
+//  - BlockBriefly: the writer waits up to the block timeout for the reader to make room, then
+//    drops whatever still does not fit from the end of the write.
+//
+// The reader can wait for data instead of polling; a wait that times out counts as an underrun
+// (capture stalled or stopped delivering), once per stall.
+class CaptureFifo {
+public:
+    enum class Policy { DropOldest, BlockBriefly };
+
+    struct Stats
+    {
+        int capacity { 0 };
+        int maxCapacity { 0 };
+        int fill { 0 };
+        int highWatermark { 0 };            // largest fill seen since the last resetStats()
+        uint64_t samplesWritten { 0 };
+        uint64_t samplesRead { 0 };
+        uint64_t samplesDropped { 0 };      // oldest skipped by the reader, newest refused by the writer, or cleared
+        uint64_t overruns { 0 };            // writes that did not fit
+        uint64_t underruns { 0 };           // stalls, once each however many reader waits time out in one
+        uint64_t growths { 0 };
+    };
+
+    CaptureFifo(int initialCapacity, int maxCapacityToUse)
+        : maxCapacity(juce::jmax(initialCapacity, maxCapacityToUse)),
+          capacity(juce::jmax(1, initialCapacity))
+    {
+        // Twice the largest capacity, so a DropOldest write rarely lands on samples the reader
+        // is still copying
+        int size = 1;
+        while (size < 2 * maxCapacity) size <<= 1;
+        storage.assign((size_t) size, 0.0f);
+        mask = (uint64_t) size - 1;
+    }
+
+    // Configuration; callable from any thread
+    void setPolicy(Policy p) noexcept                     { policy.store(p, std::memory_order_relaxed); }
+    Policy getPolicy() const noexcept                     { return policy.load(std::memory_order_relaxed); }
+    void setBlockTimeoutMs(int ms) noexcept               { blockTimeoutMs.store(juce::jmax(0, ms), std::memory_order_relaxed); }
+    void setAutoGrow(bool shouldGrow) noexcept            { autoGrow.store(shouldGrow, std::memory_order_relaxed); }
+    void setCapacity(int samples) noexcept                { capacity.store(juce::jlimit(1, maxCapacity, samples), std::memory_order_relaxed); }
+    int getCapacity() const noexcept                      { return capacity.load(std::memory_order_relaxed); }
+    int getMaxCapacity() const noexcept                   { return maxCapacity; }
+
+    // Producer: fill(float* dest, int firstSample, int numSamples) writes samples
+    // [firstSample, firstSample + numSamples) of the packet into dest, in one or two calls.
+    // Returns the number of samples accepted.
+    template <typename Fill>
+    int write(int numSamples, Fill&& fill)
+    {
+        if (numSamples <= 0) return 0;
+        const uint64_t w = writePos.load(std::memory_order_relaxed);
+        int fillLevel = (int) (w - readPos.load(std::memory_order_acquire));
+        int cap = capacity.load(std::memory_order_relaxed);
+
+        if (fillLevel + numSamples > cap)
+        {
+            overruns.fetch_add(1, std::memory_order_relaxed);
+            if (autoGrow.load(std::memory_order_relaxed) && cap < maxCapacity)
+            {
+                int grown = cap;
+                while (grown < maxCapacity && fillLevel + numSamples > grown)
+                    grown = juce::jmin(maxCapacity, grown * 2);
+                capacity.store(grown, std::memory_order_relaxed);
+                growths.fetch_add(1, std::memory_order_relaxed);
+                cap = grown;
+            }
+            if (fillLevel + numSamples > cap && policy.load(std::memory_order_relaxed) == Policy::BlockBriefly)
+                fillLevel = waitForSpace(numSamples, cap);
+        }
+
+        int first = 0;
+        int count = numSamples;
+        if (count > cap)
+        {
+            first = count - cap; // a packet larger than the whole FIFO keeps its newest part
+            count = cap;
+        }
+        if (fillLevel + count > cap)
+        {
+            if (policy.load(std::memory_order_relaxed) == Policy::DropOldest)
+                fillLevel = dropOldest(w, cap - count);
+            else
+                count = juce::jmax(0, cap - fillLevel);
+        }
+        if (count < numSamples)
+            samplesDropped.fetch_add((uint64_t) (numSamples - count), std::memory_order_relaxed);
+        if (count == 0) return 0;
+
+        const size_t start = (size_t) (w & mask);
+        const int size1 = juce::jmin(count, (int) (storage.size() - start));
+        fill(storage.data() + start, first, size1);
+        if (count > size1)
+            fill(storage.data(), first + size1, count - size1);
+
+        writePos.store(w + (uint64_t) count, std::memory_order_seq_cst);
+        samplesWritten.fetch_add((uint64_t) count, std::memory_order_relaxed);
+        updateHighWatermark(juce::jmin(fillLevel + count, cap));
+        if (readerWaiting.load(std::memory_order_seq_cst))
+            dataReady.signal();
+        return count;
+    }
+
+    // Consumer: copies up to maxSamples into dest. With timeoutMs > 0 an empty FIFO is waited on;
+    // returns 0 if nothing arrived in time.
+    int read(float* dest, int maxSamples, int timeoutMs = 0)
+    {
+        int available = trimToCapacity();
+        if (available == 0 && timeoutMs > 0)
+        {
+            readerWaiting.store(true, std::memory_order_seq_cst);
+            available = trimToCapacity();
+            if (available == 0)
+            {
+                // A timed-out wait is a stall even if wakeReader() came in just after it. The
+                // first timeout of a stall counts; later ones until data arrives do not.
+                if (! dataReady.wait((double) timeoutMs) && ! starved)
+                {
+                    starved = true;
+                    underruns.fetch_add(1, std::memory_order_relaxed);
+                }
+                available = trimToCapacity();
+            }
+            readerWaiting.store(false, std::memory_order_relaxed);
+        }
+        if (available == 0) return 0;
+        starved = false;
+
+        uint64_t r = readPos.load(std::memory_order_acquire);
+        int count = 0;
+        for (;;)
+        {
+            count = juce::jmin((int) (writePos.load(std::memory_order_acquire) - r), maxSamples);
+            if (count <= 0) return 0;
+            const size_t start = (size_t) (r & mask);
+            const int size1 = juce::jmin(count, (int) (storage.size() - start));
+            juce::FloatVectorOperations::copy(dest, storage.data() + start, size1);
+            if (count > size1)
+                juce::FloatVectorOperations::copy(dest + size1, storage.data(), count - size1);
+
+            // A DropOldest writer moves the read index before it overwrites anything, so if it
+            // is unchanged the copy is intact; otherwise read again from where the writer left it
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (readPos.compare_exchange_strong(r, r + (uint64_t) count, std::memory_order_seq_cst))
+                break;
+        }
+        samplesRead.fetch_add((uint64_t) count, std::memory_order_relaxed);
+        if (writerWaiting.load(std::memory_order_seq_cst))
+            spaceAvailable.signal();
+        return count;
+    }
+
+    // Discards everything buffered (counted as dropped), e.g. audio at a sample rate the stream
+    // no longer runs at. Reader side: call from the reader or while it is parked.
+    void clear() noexcept
+    {
+        const uint64_t w = writePos.load(std::memory_order_acquire);
+        uint64_t r = readPos.load(std::memory_order_acquire);
+        while (r != w && ! readPos.compare_exchange_weak(r, w, std::memory_order_seq_cst)) {}
+        if (r == w) return;
+        samplesDropped.fetch_add(w - r, std::memory_order_relaxed);
+        if (writerWaiting.load(std::memory_order_seq_cst))
+            spaceAvailable.signal();
+    }
+
+    // Wakes a reader blocked in read() without counting an underrun (shutdown, parking)
+    void wakeReader()
+    {
+        dataReady.signal();
+    }
+
+    int getNumReady() const noexcept
+    {
+        return (int) (writePos.load(std::memory_order_acquire) - readPos.load(std::memory_order_acquire));
+    }
+
+    Stats getStats() const noexcept
+    {
+        Stats s;
+        s.capacity = capacity.load(std::memory_order_relaxed);
+        s.maxCapacity = maxCapacity;
+        s.fill = juce::jmin(getNumReady(), s.capacity);
+        s.highWatermark = highWatermark.load(std::memory_order_relaxed);
+        s.samplesWritten = samplesWritten.load(std::memory_order_relaxed);
+        s.samplesRead = samplesRead.load(std::memory_order_relaxed);
+        s.samplesDropped = samplesDropped.load(std::memory_order_relaxed);
+        s.overruns = overruns.load(std::memory_order_relaxed);
+        s.underruns = underruns.load(std::memory_order_relaxed);
+        s.growths = growths.load(std::memory_order_relaxed);
+        return s;
+    }
+
+    // Counters restart from zero; capacity and contents are kept
+    void resetStats() noexcept
+    {
+        highWatermark.store(0, std::memory_order_relaxed);
+        samplesWritten.store(0, std::memory_order_relaxed);
+        samplesRead.store(0, std::memory_order_relaxed);
+        samplesDropped.store(0, std::memory_order_relaxed);
+        overruns.store(0, std::memory_order_relaxed);
+        underruns.store(0, std::memory_order_relaxed);
+        growths.store(0, std::memory_order_relaxed);
+    }
+
+private:
+    // Reader side: skips the oldest samples beyond the capacity, returns what is left to read
+    int trimToCapacity() noexcept
+    {
+        const uint64_t w = writePos.load(std::memory_order_acquire);
+        uint64_t r = readPos.load(std::memory_order_acquire);
+        const int cap = capacity.load(std::memory_order_relaxed);
+        while ((int) (w - r) > cap)
+        {
+            const uint64_t target = w - (uint64_t) cap;
+            if (readPos.compare_exchange_weak(r, target, std::memory_order_seq_cst))
+            {
+                samplesDropped.fetch_add(target - r, std::memory_order_relaxed);
+                return cap;
+            }
+        }
+        return (int) (w - r);
+    }
+
+    // Writer side, DropOldest: moves the read index on until at most keep samples are left
+    // unread, before the write that needs the room; returns the fill
+    int dropOldest(uint64_t w, int keep) noexcept
+    {
+        uint64_t r = readPos.load(std::memory_order_acquire);
+        while ((int) (w - r) > keep)
+        {
+            const uint64_t target = w - (uint64_t) keep;
+            if (readPos.compare_exchange_weak(r, target, std::memory_order_seq_cst))
+            {
+                samplesDropped.fetch_add(target - r, std::memory_order_relaxed);
+                std::atomic_thread_fence(std::memory_order_release); // pairs with read()'s check
+                return keep;
+            }
+        }
+        return (int) (w - r);
+    }
+
+    // Writer side, BlockBriefly: waits until numSamples fit or the timeout passes; returns the fill
+    int waitForSpace(int numSamples, int cap)
+    {
+        const uint64_t w = writePos.load(std::memory_order_relaxed);
+        const double deadline = juce::Time::getMillisecondCounterHiRes() + (double) blockTimeoutMs.load(std::memory_order_relaxed);
+        int fillLevel = (int) (w - readPos.load(std::memory_order_acquire));
+        while (fillLevel + numSamples > cap)
+        {
+            const double remaining = deadline - juce::Time::getMillisecondCounterHiRes();
+            if (remaining <= 0.0) break;
+            writerWaiting.store(true, std::memory_order_seq_cst);
+            fillLevel = (int) (w - readPos.load(std::memory_order_seq_cst));
+            if (fillLevel + numSamples > cap)
+                spaceAvailable.wait(remaining);
+            writerWaiting.store(false, std::memory_order_relaxed);
+            fillLevel = (int) (w - readPos.load(std::memory_order_acquire));
+        }
+        return fillLevel;
+    }
+
+    void updateHighWatermark(int fillLevel) noexcept
+    {
+        int seen = highWatermark.load(std::memory_order_relaxed);
+        while (fillLevel > seen && ! highWatermark.compare_exchange_weak(seen, fillLevel, std::memory_order_relaxed)) {}
+    }
+
+    const int maxCapacity;
+    std::vector<float> storage; // power-of-two size >= 2 * maxCapacity
+    uint64_t mask { 0 };
+    std::atomic<uint64_t> writePos { 0 };
+    std::atomic<uint64_t> readPos { 0 };
+    std::atomic<int> capacity;
+    std::atomic<Policy> policy { Policy::DropOldest };
+    std::atomic<int> blockTimeoutMs { 5 };
+    std::atomic<bool> autoGrow { true };
+
+    std::atomic<bool> readerWaiting { false };
+    std::atomic<bool> writerWaiting { false };
+    bool starved { false }; // reader only
+    juce::WaitableEvent dataReady;
+    juce::WaitableEvent spaceAvailable;
+
+    std::atomic<int> highWatermark { 0 };
+    std::atomic<uint64_t> samplesWritten { 0 };
+    std::atomic<uint64_t> samplesRead { 0 };
+    std::atomic<uint64_t> samplesDropped { 0 };
+    std::atomic<uint64_t> overruns { 0 };
+    std::atomic<uint64_t> underruns { 0 };
+    std::atomic<uint64_t> growths { 0 };
+};
@@ -0,0 +1,265 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "FluxKernel.h"
+#include "SimdLanes.h"
+#include <array>
+#include <vector>
+#include <cmath>
+
+// Bank of feedback comb filters y[t] = a * y[t - lag] + (1 - a) * x[t], one per integer lag,
+// driven frame by frame with the mean-removed flux. A filter whose delay matches the beat
+// period resonates; its smoothed output energy is the tempo evidence for that lag.
+// Per-frame cost is one multiply-add per filter regardless of history length. Coefficients
+// and energies are contiguous per-filter arrays; the delay lines share one buffer.
+//
+// Frames are buffered and run through the filters blockFrames at a time, eight filters per
+// SIMD pass: the next block of each filter's delay line is contiguous (a filter's lag is at
+// least a block), so eight of them are loaded as rows, transposed to one row per frame and
+// advanced together; the wrap is checked once per filter per block, not per frame. The block
+// is flushed when full and before the scores are read.
+class CombFilterBank {
+public:
+    static constexpr int blockFrames = 8;
+
+    // Filters for every lag in [minLag, maxLag] at the given flux frame rate
+    void prepare(int minLagFrames, int maxLagFrames, double framesPerSecondIn)
+    {
+        minLag = juce::jmax(1, minLagFrames);
+        maxLag = juce::jmax(minLag, maxLagFrames);
+        framesPerSecond = framesPerSecondIn;
+        const size_t n = (size_t) (maxLag - minLag + 1);
+
+        feedback.assign(n, 0.0f);
+        inputGain.assign(n, 0.0f);
+        energyGain.assign(n, 0.0f);
+        varianceGain.assign(n, 0.0f);
+        energy.assign(n, 0.0f);
+        delayOffset.assign(n, 0);
+        delayPos.assign(n, 0);
+
+        size_t total = 0;
+        for (size_t k = 0; k < n; ++k)
+        {
+            delayOffset[k] = total;
+            total += (size_t) (minLag + (int) k);
+        }
+        delay.assign(total, 0.0f);
+
+        updateCoefficients();
+        reset();
+    }
+
+    // Feedback decay of each comb (same half-life in seconds for every lag) and the
+    // smoothing of the energy, mean and variance trackers
+    void setHalfLives(double combSec, double energySec)
+    {
+        combHalfLifeSec = juce::jlimit(0.25, 10.0, combSec);
+        energyHalfLifeSec = juce::jlimit(0.25, 20.0, energySec);
+        flush();
+        updateCoefficients();
+    }
+
+    void reset()
+    {
+        std::fill(delay.begin(), delay.end(), 0.0f);
+        std::fill(energy.begin(), energy.end(), 0.0f);
+        std::fill(delayPos.begin(), delayPos.end(), 0);
+        numPending = 0;
+        mean = 0.0f;
+        variance = 0.0f;
+    }
+
+    // One flux frame
+    void process(float x)
+    {
+        mean += smoothing * (x - mean);
+        const float c = x - mean;
+        variance += smoothing * (c * c - variance);
+
+        pending[(size_t) numPending] = c;
+        if (++numPending == juce::jmin(blockFrames, minLag))
+            flush();
+    }
+
+    // Runs the buffered frames through every filter
+    void flush()
+    {
+        const int frames = numPending;
+        if (frames == 0) return;
+        numPending = 0;
+
+        // Frames is a template argument so the eight rows stay in registers. Below four
+        // the two transposes per group cost more than they save, so filters run one by one.
+        int grouped = 0;
+        switch (frames)
+        {
+            case 1: case 2: case 3: break;
+            case 4: grouped = filterGroups<4>(); break;
+            case 5: grouped = filterGroups<5>(); break;
+            case 6: grouped = filterGroups<6>(); break;
+            case 7: grouped = filterGroups<7>(); break;
+            default: grouped = filterGroups<8>(); break;
+        }
+        for (int k = grouped; k < getNumFilters(); ++k)
+            filterOne(k, frames);
+
+        // A block is at most minLag frames, so each position wraps at most once
+        int* positions = delayPos.data();
+        for (int f = 0; f < grouped; ++f)
+        {
+            const int p = positions[f] + frames;
+            positions[f] = p >= minLag + f ? p - (minLag + f) : p;
+        }
+    }
+
+    // Writes an autocorrelation-like score to dest[lag] for lag in [minLag, maxLag] and returns
+    // the input variance. For a comb with feedback a, output energy E and input variance R0
+    // relate to the input autocovariance R by
+    //   E (1 + a) / (1 - a) = R0 + 2 * sum_{d>=1} a^d R(d * lag).
+    // The score (1 - a) * sum_{d>=1} a^d R(d * lag) is a times a weighted average of R(lag),
+    // R(2 lag), ...: bounded by R0, and of two equally periodic lags the shorter one (larger a)
+    // scores higher, which favours the beat over its sub-harmonics.
+    float getLagScores(float* dest)
+    {
+        flush();
+        const int n = getNumFilters();
+        for (int k = 0; k < n; ++k)
+            dest[minLag + k] = energy[(size_t) k] * energyGain[(size_t) k] - variance * varianceGain[(size_t) k];
+        return variance;
+    }
+
+    int getNumFilters() const { return (int) feedback.size(); }
+
+private:
+    // The next blockFrames slots of filter k's delay line, wrapping at its end
+    SimdLanes::F8 loadBlock(int k) const noexcept
+    {
+        const float* line = delay.data() + delayOffset[(size_t) k];
+        const int lag = minLag + k;
+        const int pos = delayPos[(size_t) k];
+        if (pos + blockFrames <= lag)
+            return SimdLanes::loadUnaligned(line + pos);
+        alignas(32) float wrapped[blockFrames];
+        for (int i = 0; i < blockFrames; ++i)
+            wrapped[i] = line[wrapIndex(pos + i, lag)];
+        return SimdLanes::load(wrapped);
+    }
+
+    // Writes back the first frames slots of a block read by loadBlock (the rest are unchanged)
+    void storeBlock(int k, SimdLanes::F8 block, int frames) noexcept
+    {
+        float* line = delay.data() + delayOffset[(size_t) k];
+        const int lag = minLag + k;
+        const int pos = delayPos[(size_t) k];
+        if (pos + blockFrames <= lag)
+        {
+            SimdLanes::storeUnaligned(line + pos, block);
+            return;
+        }
+        alignas(32) float wrapped[blockFrames];
+        SimdLanes::store(wrapped, block);
+        for (int i = 0; i < frames; ++i)
+            line[wrapIndex(pos + i, lag)] = wrapped[i];
+    }
+
+    static int wrapIndex(int i, int lag) noexcept
+    {
+        return i < lag ? i : (lag >= blockFrames ? i - lag : i % lag);
+    }
+
+    // Filters whole groups of eight over the pending frames (positions are advanced by flush);
+    // returns the number of filters done
+    template <int Frames>
+    int filterGroups() noexcept
+    {
+        using namespace SimdLanes;
+        const int n = getNumFilters();
+        const F8 s = set1(smoothing);
+        F8 in[Frames];
+        for (int i = 0; i < Frames; ++i)
+            in[i] = set1(pending[(size_t) i]);
+
+        int k = 0;
+        for (; k + 8 <= n; k += 8)
+        {
+            F8 rows[8];
+            for (int j = 0; j < 8; ++j)
+                rows[j] = loadBlock(k + j);
+            transpose(rows); // rows[i]: slot of frame i for the eight filters
+
+            const F8 a = load(feedback.data() + k);
+            const F8 b = load(inputGain.data() + k);
+            F8 e = load(energy.data() + k);
+            for (int i = 0; i < Frames; ++i)
+            {
+                const F8 y = add(mul(a, rows[i]), mul(b, in[i]));
+                rows[i] = y;
+                e = add(e, mul(s, sub(mul(y, y), e)));
+            }
+            store(energy.data() + k, e);
+
+            transpose(rows);
+            for (int j = 0; j < 8; ++j)
+                storeBlock(k + j, rows[j], Frames);
+        }
+        return k;
+    }
+
+    // One filter over the pending frames, in at most two wrap-free segments; advances its position
+    void filterOne(int k, int frames) noexcept
+    {
+        float* line = delay.data() + delayOffset[(size_t) k];
+        const int lag = minLag + k;
+        const int pos = delayPos[(size_t) k];
+        const float a = feedback[(size_t) k];
+        const float b = inputGain[(size_t) k];
+        float e = energy[(size_t) k];
+        const int first = juce::jmin(frames, lag - pos);
+        for (int i = 0; i < frames; ++i)
+        {
+            float& slot = line[i < first ? pos + i : i - first];
+            const float y = a * slot + b * pending[(size_t) i];
+            slot = y;
+            e += smoothing * (y * y - e);
+        }
+        energy[(size_t) k] = e;
+        delayPos[(size_t) k] = first < frames ? frames - first : pos + frames;
+    }
+
+    void updateCoefficients()
+    {
+        const double combFrames = juce::jmax(1.0, combHalfLifeSec * framesPerSecond);
+        const double energyFrames = juce::jmax(1.0, energyHalfLifeSec * framesPerSecond);
+        smoothing = (float) (1.0 - std::pow(0.5, 1.0 / energyFrames));
+        for (int k = 0; k < getNumFilters(); ++k)
+        {
+            const double a = std::pow(0.5, (double) (minLag + k) / combFrames);
+            feedback[(size_t) k] = (float) a;
+            inputGain[(size_t) k] = (float) (1.0 - a);
+            energyGain[(size_t) k] = (float) ((1.0 + a) / 2.0);
+            varianceGain[(size_t) k] = (float) ((1.0 - a) / 2.0);
+        }
+    }
+
+    int minLag { 1 };
+    int maxLag { 1 };
+    double framesPerSecond { 100.0 };
+    double combHalfLifeSec { 1.5 };
+    double energyHalfLifeSec { 2.0 };
+
+    AlignedFloatVector feedback;
+    AlignedFloatVector inputGain;
+    AlignedFloatVector energyGain;
+    AlignedFloatVector varianceGain;
+    AlignedFloatVector energy;
+    std::vector<size_t> delayOffset;
+    std::vector<int> delayPos;
+    std::vector<float> delay; // all delay lines back to back, filter k owns minLag + k slots
+    std::array<float, blockFrames> pending {}; // mean-removed frames not yet filtered
+    int numPending { 0 };
+
+    float smoothing { 0.0f };
+    float mean { 0.0f };
+    float variance { 0.0f };
+};
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <memory>
+
+#if MASTER_TEMPO_HAS_PFFFT
+ #include <pffft.h>
+#endif
+
+// FFT implementations the DSP code can run on. Pffft is only available when the build
+// enables MASTER_TEMPO_WITH_PFFFT; requesting it otherwise falls back to Juce.
+enum class FftBackend
+{
+    Juce,  // juce::dsp::FFT (whatever engine JUCE was built with)
+    Pffft  // pffft SIMD real FFT
+};
+
+// Real-only FFT of a fixed power-of-two size, using JUCE's real-only layout on both sides:
+// buffers hold 2 * size floats, the spectrum is (re, im) pairs for bins 0..size/2 and the
+// inverse is scaled by 1/size. Transforms are const and keep no per-call state in the object,
+// so one instance can be shared between threads. Buffers must be 16-byte aligned.
+class RealFft {
+public:
+    virtual ~RealFft() = default;
+
+    virtual FftBackend getBackend() const noexcept = 0;
+    int getSize() const noexcept { return size; }
+
+    // In place: size real samples in, size / 2 + 1 complex bins out
+    virtual void forward(float* data) const noexcept = 0;
+    // In place: size / 2 + 1 complex bins in, size real samples out
+    virtual void inverse(float* data) const noexcept = 0;
+
+protected:
+    explicit RealFft(int fftSize) : size(fftSize) {}
+    int size;
+};
+
+class JuceRealFft : public RealFft {
+public:
+    explicit JuceRealFft(int order) : RealFft(1 << order), fft(order) {}
+
+    FftBackend getBackend() const noexcept override { return FftBackend::Juce; }
+    void forward(float* data) const noexcept override { fft.performRealOnlyForwardTransform(data); }
+    void inverse(float* data) const noexcept override { fft.performRealOnlyInverseTransform(data); }
+
+private:
+    juce::dsp::FFT fft;
+};
+
+#if MASTER_TEMPO_HAS_PFFFT
+// pffft's ordered real layout is [dc, nyquist, re1, im1, ..., re(n/2-1), im(n/2-1)]; the
+// DC/Nyquist pair is moved to and from JUCE's bin positions around the transform. A null work
+// buffer makes pffft use stack scratch, keeping the setup read-only.
+class PffftRealFft : public RealFft {
+public:
+    // Returns nullptr if pffft does not support the size (real transforms need a multiple of 32)
+    static std::unique_ptr<RealFft> create(int order)
+    {
+        PFFFT_Setup* s = pffft_new_setup(1 << order, PFFFT_REAL);
+        if (s == nullptr) return nullptr;
+        return std::unique_ptr<RealFft>(new PffftRealFft(order, s));
+    }
+
+    ~PffftRealFft() override { pffft_destroy_setup(setup); }
+
+    FftBackend getBackend() const noexcept override { return FftBackend::Pffft; }
+
+    void forward(float* data) const noexcept override
+    {
+        jassert(((uintptr_t) data & 15) == 0);
+        pffft_transform_ordered(setup, data, data, nullptr, PFFFT_FORWARD);
+        const float nyquist = data[1];
+        data[1] = 0.0f;
+        data[size] = nyquist;
+        data[size + 1] = 0.0f;
+    }
+
+    void inverse(float* data) const noexcept override
+    {
+        jassert(((uintptr_t) data & 15) == 0);
+        data[1] = data[size];
+        pffft_transform_ordered(setup, data, data, nullptr, PFFFT_BACKWARD);
+        juce::FloatVectorOperations::multiply(data, 1.0f / (float) size, size);
+    }
+
+private:
+    PffftRealFft(int order, PFFFT_Setup* s) : RealFft(1 << order), setup(s) {}
+
+    PFFFT_Setup* setup;
+};
+#endif
+
+inline bool isFftBackendAvailable(FftBackend backend) noexcept
+{
+   #if MASTER_TEMPO_HAS_PFFFT
+    juce::ignoreUnused(backend);
+    return true;
+   #else
+    return backend == FftBackend::Juce;
+   #endif
+}
+
+// Plan for 2^order points on the requested backend, or on JUCE if that backend cannot do it
+inline std::unique_ptr<RealFft> createRealFft(FftBackend backend, int order)
+{
+   #if MASTER_TEMPO_HAS_PFFFT
+    if (backend == FftBackend::Pffft)
+        if (auto plan = PffftRealFft::create(order))
+            return plan;
+   #else
+    juce::ignoreUnused(backend);
+   #endif
+    return std::make_unique<JuceRealFft>(order);
+}
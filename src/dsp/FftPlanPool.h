@@ -0,0 +1,75 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "FftBackend.h"
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <cmath>
+
+// Process-wide cache of FFT plans (per backend and size) and Hann windows (per size). Entries
+// are created on first request, never modified or freed afterwards, and handed out by
+// reference, so every front-end and estimator of a given size shares one set of twiddle tables.
+// Lookups take a lock: fetch references when preparing, not per frame.
+// The default backend applies to plans fetched after it is set; existing holders keep theirs.
+class FftPlanPool {
+public:
+    static FftPlanPool& getInstance()
+    {
+        static FftPlanPool pool;
+        return pool;
+    }
+
+    const RealFft& getPlan(int order) { return getPlan(order, getDefaultBackend()); }
+
+    const RealFft& getPlan(int order, FftBackend backend)
+    {
+        jassert(order > 0 && order < 24);
+        std::lock_guard<std::mutex> lock(mutex);
+        auto& plan = plans[{ (int) backend, order }];
+        if (!plan)
+            plan = createRealFft(backend, order);
+        return *plan;
+    }
+
+    void setDefaultBackend(FftBackend backend)
+    {
+        jassert(isFftBackendAvailable(backend));
+        defaultBackend.store(isFftBackendAvailable(backend) ? backend : FftBackend::Juce);
+    }
+
+    FftBackend getDefaultBackend() const { return defaultBackend.load(); }
+
+    // Symmetric Hann window of the given length, computed in float as the STFT always has
+    const std::vector<float>& getHannWindow(int size)
+    {
+        jassert(size > 1);
+        std::lock_guard<std::mutex> lock(mutex);
+        auto& window = hannWindows[size];
+        if (!window)
+        {
+            auto w = std::make_unique<std::vector<float>>((size_t) size);
+            for (int i = 0; i < size; ++i)
+                (*w)[(size_t) i] = 0.5f * (1.0f - std::cos(2.0f * juce::MathConstants<float>::pi * (float) i / (float) (size - 1)));
+            window = std::move(w);
+        }
+        return *window;
+    }
+
+    static int orderForSize(int size)
+    {
+        int order = 0;
+        while ((1 << order) < size) ++order;
+        return order;
+    }
+
+private:
+    FftPlanPool() = default;
+
+    std::mutex mutex;
+    std::map<std::pair<int, int>, std::unique_ptr<RealFft>> plans; // (backend, order)
+    std::atomic<FftBackend> defaultBackend { isFftBackendAvailable(FftBackend::Pffft) ? FftBackend::Pffft : FftBackend::Juce };
+    std::map<int, std::unique_ptr<const std::vector<float>>> hannWindows;
+};
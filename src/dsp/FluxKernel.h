@@ -0,0 +1,188 @@
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <new>
+#include <vector>
+
+#if defined(__AVX2__)
+ #include <immintrin.h>
+ #define MASTER_TEMPO_FLUX_AVX2 1
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+ #include <emmintrin.h>
+ #define MASTER_TEMPO_FLUX_SSE2 1
+#elif defined(__aarch64__) || defined(_M_ARM64)
+ #include <arm_neon.h>
+ #define MASTER_TEMPO_FLUX_NEON 1
+#endif
+
+// Minimal aligned allocator so SoA spectral buffers can be read with aligned SIMD loads
+template <typename T, std::size_t Alignment>
+struct AlignedAllocator
+{
+    using value_type = T;
+    template <typename U> struct rebind { using other = AlignedAllocator<U, Alignment>; };
+
+    AlignedAllocator() noexcept = default;
+    template <typename U> AlignedAllocator(const AlignedAllocator<U, Alignment>&) noexcept {}
+
+    T* allocate(std::size_t n) { return static_cast<T*>(::operator new(n * sizeof(T), std::align_val_t(Alignment))); }
+    void deallocate(T* p, std::size_t) noexcept { ::operator delete(p, std::align_val_t(Alignment)); }
+
+    template <typename U> bool operator==(const AlignedAllocator<U, Alignment>&) const noexcept { return true; }
+    template <typename U> bool operator!=(const AlignedAllocator<U, Alignment>&) const noexcept { return false; }
+};
+
+using AlignedFloatVector = std::vector<float, AlignedAllocator<float, 32>>;
+
+// Complex-domain spectral flux over one band:
+//   sum_k max(0, |X_k| - |X'_k| cos(angle(X_k) - angle(X'_k)))
+// where X' is the previous frame. cos falls back to 1 when either magnitude is ~0.
+// Previous-frame state (prevRe/prevIm/prevMag) is updated in place.
+//
+// Alignment: re/im may be unaligned; prevRe/prevIm/prevMag must be 32-byte aligned.
+// Tolerance: per-bin terms use the same IEEE operations as the scalar reference, but the
+// vector paths accumulate in lanes, so the sum can differ from complexDomainFluxScalar by
+// reordering only (relative difference below 1e-5 for band widths used here).
+namespace FluxKernel
+{
+    constexpr float magEpsilon = 1.0e-12f;
+
+    inline float complexDomainFluxScalar(const float* re, const float* im,
+                                         float* prevRe, float* prevIm, float* prevMag,
+                                         int numBins) noexcept
+    {
+        float flux = 0.0f;
+        for (int k = 0; k < numBins; ++k)
+        {
+            const float mag = std::sqrt(re[k] * re[k] + im[k] * im[k]);
+            const float prevMagK = prevMag[k];
+            const float dot = re[k] * prevRe[k] + im[k] * prevIm[k];
+            const float cosDelta = (prevMagK > magEpsilon && mag > magEpsilon) ? (dot / (mag * prevMagK)) : 1.0f;
+            const float term = mag - prevMagK * cosDelta;
+            flux += term > 0.0f ? term : 0.0f;
+            prevMag[k] = mag;
+            prevRe[k] = re[k];
+            prevIm[k] = im[k];
+        }
+        return flux;
+    }
+
+#if MASTER_TEMPO_FLUX_AVX2
+    inline __m256 fluxTerm8(__m256 r, __m256 i, __m256 pr, __m256 pi, __m256 pm, __m256 eps, __m256 one) noexcept
+    {
+        const __m256 mag = _mm256_sqrt_ps(_mm256_add_ps(_mm256_mul_ps(r, r), _mm256_mul_ps(i, i)));
+        const __m256 dot = _mm256_add_ps(_mm256_mul_ps(r, pr), _mm256_mul_ps(i, pi));
+        const __m256 valid = _mm256_and_ps(_mm256_cmp_ps(pm, eps, _CMP_GT_OQ), _mm256_cmp_ps(mag, eps, _CMP_GT_OQ));
+        const __m256 cosDelta = _mm256_blendv_ps(one, _mm256_div_ps(dot, _mm256_mul_ps(mag, pm)), valid);
+        const __m256 term = _mm256_sub_ps(mag, _mm256_mul_ps(pm, cosDelta));
+        return _mm256_max_ps(term, _mm256_setzero_ps());
+    }
+
+    inline __m256 magnitude8(__m256 r, __m256 i) noexcept
+    {
+        return _mm256_sqrt_ps(_mm256_add_ps(_mm256_mul_ps(r, r), _mm256_mul_ps(i, i)));
+    }
+#elif MASTER_TEMPO_FLUX_SSE2
+    inline __m128 fluxTerm4(__m128 r, __m128 i, __m128 pr, __m128 pi, __m128 pm, __m128 eps, __m128 one) noexcept
+    {
+        const __m128 mag = _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(r, r), _mm_mul_ps(i, i)));
+        const __m128 dot = _mm_add_ps(_mm_mul_ps(r, pr), _mm_mul_ps(i, pi));
+        const __m128 valid = _mm_and_ps(_mm_cmpgt_ps(pm, eps), _mm_cmpgt_ps(mag, eps));
+        const __m128 ratio = _mm_div_ps(dot, _mm_mul_ps(mag, pm));
+        const __m128 cosDelta = _mm_or_ps(_mm_and_ps(valid, ratio), _mm_andnot_ps(valid, one));
+        const __m128 term = _mm_sub_ps(mag, _mm_mul_ps(pm, cosDelta));
+        return _mm_max_ps(term, _mm_setzero_ps());
+    }
+
+    inline __m128 magnitude4(__m128 r, __m128 i) noexcept
+    {
+        return _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(r, r), _mm_mul_ps(i, i)));
+    }
+#elif MASTER_TEMPO_FLUX_NEON
+    inline float32x4_t fluxTerm4(float32x4_t r, float32x4_t i, float32x4_t pr, float32x4_t pi, float32x4_t pm, float32x4_t eps, float32x4_t one) noexcept
+    {
+        const float32x4_t mag = vsqrtq_f32(vaddq_f32(vmulq_f32(r, r), vmulq_f32(i, i)));
+        const float32x4_t dot = vaddq_f32(vmulq_f32(r, pr), vmulq_f32(i, pi));
+        const uint32x4_t valid = vandq_u32(vcgtq_f32(pm, eps), vcgtq_f32(mag, eps));
+        const float32x4_t cosDelta = vbslq_f32(valid, vdivq_f32(dot, vmulq_f32(mag, pm)), one);
+        const float32x4_t term = vsubq_f32(mag, vmulq_f32(pm, cosDelta));
+        return vmaxq_f32(term, vdupq_n_f32(0.0f));
+    }
+
+    inline float32x4_t magnitude4(float32x4_t r, float32x4_t i) noexcept
+    {
+        return vsqrtq_f32(vaddq_f32(vmulq_f32(r, r), vmulq_f32(i, i)));
+    }
+#endif
+
+    inline float complexDomainFlux(const float* re, const float* im,
+                                   float* prevRe, float* prevIm, float* prevMag,
+                                   int numBins) noexcept
+    {
+        int k = 0;
+        float flux = 0.0f;
+#if MASTER_TEMPO_FLUX_AVX2
+        const __m256 eps = _mm256_set1_ps(magEpsilon);
+        const __m256 one = _mm256_set1_ps(1.0f);
+        __m256 acc0 = _mm256_setzero_ps();
+        __m256 acc1 = _mm256_setzero_ps();
+        for (; k + 16 <= numBins; k += 16)
+        {
+            const __m256 r0 = _mm256_loadu_ps(re + k),     i0 = _mm256_loadu_ps(im + k);
+            const __m256 r1 = _mm256_loadu_ps(re + k + 8), i1 = _mm256_loadu_ps(im + k + 8);
+            const __m256 pm0 = _mm256_load_ps(prevMag + k), pm1 = _mm256_load_ps(prevMag + k + 8);
+            acc0 = _mm256_add_ps(acc0, fluxTerm8(r0, i0, _mm256_load_ps(prevRe + k),     _mm256_load_ps(prevIm + k),     pm0, eps, one));
+            acc1 = _mm256_add_ps(acc1, fluxTerm8(r1, i1, _mm256_load_ps(prevRe + k + 8), _mm256_load_ps(prevIm + k + 8), pm1, eps, one));
+            _mm256_store_ps(prevMag + k,     magnitude8(r0, i0));
+            _mm256_store_ps(prevMag + k + 8, magnitude8(r1, i1));
+            _mm256_store_ps(prevRe + k, r0); _mm256_store_ps(prevRe + k + 8, r1);
+            _mm256_store_ps(prevIm + k, i0); _mm256_store_ps(prevIm + k + 8, i1);
+        }
+        alignas(32) float lanes[8];
+        _mm256_store_ps(lanes, _mm256_add_ps(acc0, acc1));
+        for (float v : lanes) flux += v;
+#elif MASTER_TEMPO_FLUX_SSE2
+        const __m128 eps = _mm_set1_ps(magEpsilon);
+        const __m128 one = _mm_set1_ps(1.0f);
+        __m128 acc0 = _mm_setzero_ps();
+        __m128 acc1 = _mm_setzero_ps();
+        for (; k + 8 <= numBins; k += 8)
+        {
+            const __m128 r0 = _mm_loadu_ps(re + k),     i0 = _mm_loadu_ps(im + k);
+            const __m128 r1 = _mm_loadu_ps(re + k + 4), i1 = _mm_loadu_ps(im + k + 4);
+            const __m128 pm0 = _mm_load_ps(prevMag + k), pm1 = _mm_load_ps(prevMag + k + 4);
+            acc0 = _mm_add_ps(acc0, fluxTerm4(r0, i0, _mm_load_ps(prevRe + k),     _mm_load_ps(prevIm + k),     pm0, eps, one));
+            acc1 = _mm_add_ps(acc1, fluxTerm4(r1, i1, _mm_load_ps(prevRe + k + 4), _mm_load_ps(prevIm + k + 4), pm1, eps, one));
+            _mm_store_ps(prevMag + k,     magnitude4(r0, i0));
+            _mm_store_ps(prevMag + k + 4, magnitude4(r1, i1));
+            _mm_store_ps(prevRe + k, r0); _mm_store_ps(prevRe + k + 4, r1);
+            _mm_store_ps(prevIm + k, i0); _mm_store_ps(prevIm + k + 4, i1);
+        }
+        alignas(16) float lanes[4];
+        _mm_store_ps(lanes, _mm_add_ps(acc0, acc1));
+        for (float v : lanes) flux += v;
+#elif MASTER_TEMPO_FLUX_NEON
+        const float32x4_t eps = vdupq_n_f32(magEpsilon);
+        const float32x4_t one = vdupq_n_f32(1.0f);
+        float32x4_t acc0 = vdupq_n_f32(0.0f);
+        float32x4_t acc1 = vdupq_n_f32(0.0f);
+        for (; k + 8 <= numBins; k += 8)
+        {
+            const float32x4_t r0 = vld1q_f32(re + k),     i0 = vld1q_f32(im + k);
+            const float32x4_t r1 = vld1q_f32(re + k + 4), i1 = vld1q_f32(im + k + 4);
+            const float32x4_t pm0 = vld1q_f32(prevMag + k), pm1 = vld1q_f32(prevMag + k + 4);
+            acc0 = vaddq_f32(acc0, fluxTerm4(r0, i0, vld1q_f32(prevRe + k),     vld1q_f32(prevIm + k),     pm0, eps, one));
+            acc1 = vaddq_f32(acc1, fluxTerm4(r1, i1, vld1q_f32(prevRe + k + 4), vld1q_f32(prevIm + k + 4), pm1, eps, one));
+            vst1q_f32(prevMag + k,     magnitude4(r0, i0));
+            vst1q_f32(prevMag + k + 4, magnitude4(r1, i1));
+            vst1q_f32(prevRe + k, r0); vst1q_f32(prevRe + k + 4, r1);
+            vst1q_f32(prevIm + k, i0); vst1q_f32(prevIm + k + 4, i1);
+        }
+        flux += vaddvq_f32(vaddq_f32(acc0, acc1));
+#endif
+        if (k < numBins)
+            flux += complexDomainFluxScalar(re + k, im + k, prevRe + k, prevIm + k, prevMag + k, numBins - k);
+        return flux;
+    }
+}
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <vector>
+#include <cmath>
+
+// Histogram of inter-onset intervals between minIoiSec and maxIoiSec at 0.25 ms resolution.
+// Counts live in a Fenwick tree, so add/remove, range counts and quantiles are all
+// O(log bins) regardless of how many intervals are held. The IQR outlier fences are
+// recomputed lazily from the quartiles after the contents change.
+class IoiHistogram {
+public:
+    static constexpr double minIoiSec = 0.02;
+    static constexpr double maxIoiSec = 3.0;
+    static constexpr double binWidthSec = 0.00025;
+
+    IoiHistogram()
+    {
+        numBins = (int) std::ceil(maxIoiSec / binWidthSec);
+        tree.assign((size_t) numBins + 1, 0);
+        topBit = 1;
+        while (topBit * 2 <= numBins) topBit *= 2;
+    }
+
+    // Intervals outside (minIoiSec, maxIoiSec) are ignored, matching the plausibility gate
+    void add(double ioi)    { update(ioi, +1); }
+    void remove(double ioi) { update(ioi, -1); }
+
+    void clear()
+    {
+        std::fill(tree.begin(), tree.end(), 0);
+        total = 0;
+        fencesDirty = true;
+    }
+
+    int size() const { return total; }
+
+    // Number of intervals in [lo, hi]
+    int countInRange(double lo, double hi) const
+    {
+        lo = juce::jmax(lo, 0.0);
+        hi = juce::jmin(hi, maxIoiSec);
+        if (hi < lo || total == 0) return 0;
+        return prefix(binOf(hi)) - prefix(binOf(lo) - 1);
+    }
+
+    // Value at sorted index floor(q * (size - 1)), quantised to the bin centre
+    double quantile(double q) const
+    {
+        jassert(total > 0);
+        const int k = (int) juce::jlimit<double>(0.0, (double) (total - 1), q * (double) (total - 1));
+        return ((double) kth(k) + 0.5) * binWidthSec;
+    }
+
+    // Tukey fences q1 - 1.5 IQR .. q3 + 1.5 IQR, plus how many intervals fall inside them
+    struct Fences { double lo; double hi; int inside; };
+
+    const Fences& getFences() const
+    {
+        if (fencesDirty)
+        {
+            if (total == 0)
+            {
+                fences = { 0.0, maxIoiSec, 0 };
+            }
+            else
+            {
+                const double q1 = quantile(0.25);
+                const double q3 = quantile(0.75);
+                const double iqr = juce::jmax(1.0e-6, q3 - q1);
+                fences.lo = q1 - 1.5 * iqr;
+                fences.hi = q3 + 1.5 * iqr;
+                fences.inside = countInRange(fences.lo, fences.hi);
+            }
+            fencesDirty = false;
+        }
+        return fences;
+    }
+
+private:
+    int binOf(double ioi) const { return juce::jlimit(0, numBins - 1, (int) (ioi / binWidthSec)); }
+
+    void update(double ioi, int delta)
+    {
+        if (!(ioi > minIoiSec && ioi < maxIoiSec)) return;
+        for (int i = binOf(ioi) + 1; i <= numBins; i += i & -i)
+            tree[(size_t) i] += delta;
+        total += delta;
+        jassert(total >= 0);
+        fencesDirty = true;
+    }
+
+    // Count in bins 0..bin inclusive
+    int prefix(int bin) const
+    {
+        int sum = 0;
+        for (int i = bin + 1; i > 0; i -= i & -i)
+            sum += tree[(size_t) i];
+        return sum;
+    }
+
+    // Bin holding the k-th smallest interval (0-based)
+    int kth(int k) const
+    {
+        int pos = 0;
+        for (int step = topBit; step > 0; step >>= 1)
+        {
+            const int next = pos + step;
+            if (next <= numBins && tree[(size_t) next] <= k)
+            {
+                pos = next;
+                k -= tree[(size_t) next];
+            }
+        }
+        return pos; // 1-based tree index pos + 1 is the bin, i.e. 0-based bin pos
+    }
+
+    std::vector<int> tree; // 1-based Fenwick tree over numBins bins
+    int numBins { 0 };
+    int topBit { 1 };
+    int total { 0 };
+    mutable Fences fences { 0.0, maxIoiSec, 0 };
+    mutable bool fencesDirty { true };
+};
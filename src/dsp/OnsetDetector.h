@@ -1,126 +1,106 @@
 #pragma once
 
 #include <JuceHeader.h>
+#include "StftFrontEnd.h"
+#include "FluxKernel.h"
+#include "RollingMedian.h"
+#include "SpscQueue.h"
 #include <limits>
 #include <cmath>
-#include <mutex>
-#include <deque>
+#include <atomic>
 #include <algorithm>
 
+// Band-limited complex-domain onset detector. Consumes spectra from a (shared) StftFrontEnd
+// and only looks at the bins of its band, so several detectors can share one FFT per hop.
 class OnsetDetector {
 public:
     OnsetDetector(int sampleRate, int fftSize, int hopSize)
         : OnsetDetector(sampleRate, fftSize, hopSize, 0.0f, std::numeric_limits<float>::infinity()) {}
 
     OnsetDetector(int sampleRate, int fftSize, int hopSize, float bandLowHz, float bandHighHz)
-        : sampleRate(sampleRate), fftOrder(juce::roundToInt(std::log2(fftSize))), fft(fftOrder),
-          window(fftSize), prevMag(fftSize / 2 + 1, 0.0f), prevRe(fftSize / 2 + 1, 0.0f), prevIm(fftSize / 2 + 1, 0.0f), hopSize(hopSize),
+        : sampleRate(sampleRate), fftSize(fftSize), hopSize(hopSize),
           bandLowHz(bandLowHz), bandHighHz(bandHighHz)
     {
-        jassert((1 << fftOrder) == fftSize);
-        for (int i = 0; i < fftSize; ++i)
-            window[i] = 0.5f * (1.0f - std::cos(2.0f * juce::MathConstants<float>::pi * (float) i / (float) (fftSize - 1)));
+        // Determine bin range for band-limited flux
+        const int bins = fftSize / 2 + 1;
+        startBin = 0;
+        endBin = bins - 1;
+        if (bandLowHz > 0.0f || std::isfinite(bandHighHz))
+        {
+            const float hzPerBin = (float) sampleRate / (float) fftSize;
+            if (bandLowHz > 0.0f)
+                startBin = juce::jlimit(0, bins - 1, (int) std::ceil(bandLowHz / hzPerBin));
+            if (std::isfinite(bandHighHz))
+                endBin = juce::jlimit(0, bins - 1, (int) std::floor(bandHighHz / hzPerBin));
+        }
 
-        stftInput.setSize(1, fftSize);
-        stftInput.clear();
-        fifoBuffer.resize(fftSize * 2);
+        // Previous-frame spectral state for the band only (SoA, aligned for the flux kernel)
+        const size_t bandBins = (size_t) juce::jmax(0, endBin - startBin + 1);
+        prevMag.assign(bandBins, 0.0f);
+        prevRe.assign(bandBins, 0.0f);
+        prevIm.assign(bandBins, 0.0f);
     }
 
+    // Standalone use: runs a private STFT. Pipelines with several bands should share one
+    // StftFrontEnd per resolution and call processSpectrum() instead.
     void pushAudio(const float* mono, int numSamples)
     {
-        for (int i = 0; i < numSamples; ++i)
-        {
-            fifoBuffer[fifoWrite] = mono[i];
-            fifoWrite = (fifoWrite + 1) % fifoBuffer.size();
-            samplesSinceHop++;
-            if (samplesSinceHop >= hopSize)
-            {
-                samplesSinceHop = 0;
-                computeFrame();
-            }
-        }
+        if (!ownFrontEnd)
+            ownFrontEnd = std::make_unique<StftFrontEnd>(fftSize, hopSize);
+        ownFrontEnd->pushAudio(mono, numSamples, [this](const SpectrumFrame& frame) { processSpectrum(frame); });
+    }
+
+    // Consume one frame from a front-end configured with the same FFT size and hop
+    void processSpectrum(const SpectrumFrame& frame)
+    {
+        jassert(frame.fftSize == fftSize && frame.hopSize == hopSize);
+        computeFrame(frame);
     }
 
+    // Consumer side (one thread): batch-drain into caller-owned storage, returns the count copied
+    size_t drainFlux(float* dest, size_t maxCount)     { return fluxQueue.drain(dest, maxCount); }
+    size_t drainOnsets(double* dest, size_t maxCount)  { return onsetQueue.drain(dest, maxCount); }
+
+    // Convenience wrappers appending everything currently queued
     void fetchNewFlux(std::vector<float>& out)
     {
-        std::lock_guard<std::mutex> lock(queueMutex);
-        if (!newFluxFrames.empty())
-        {
-            out.insert(out.end(), newFluxFrames.begin(), newFluxFrames.end());
-            newFluxFrames.clear();
-        }
+        const size_t base = out.size();
+        out.resize(base + fluxQueue.getNumReady());
+        out.resize(base + fluxQueue.drain(out.data() + base, out.size() - base));
     }
 
     void fetchOnsets(std::vector<double>& out)
     {
-        std::lock_guard<std::mutex> lock(queueMutex);
-        if (!onsetTimesSec.empty())
-        {
-            out.insert(out.end(), onsetTimesSec.begin(), onsetTimesSec.end());
-            onsetTimesSec.clear();
-        }
+        const size_t base = out.size();
+        out.resize(base + onsetQueue.getNumReady());
+        out.resize(base + onsetQueue.drain(out.data() + base, out.size() - base));
     }
 
+    // Values dropped because the consumer fell behind by more than the queue capacity
+    uint64_t getFluxOverflowCount() const   { return fluxQueue.getOverflowCount(); }
+    uint64_t getOnsetOverflowCount() const  { return onsetQueue.getOverflowCount(); }
+
     // Update refractory window (in seconds). Caller can adapt this using current tempo.
     void setRefractorySeconds(double seconds)
     {
-        refractorySec = seconds;
+        refractorySec.store(seconds, std::memory_order_relaxed);
     }
 
     // Set the thresholding window length in seconds; converts to frames using hop size
     void setThresholdWindowSeconds(double seconds)
     {
         const double frames = seconds * (double) sampleRate / (double) juce::jmax(1, hopSize);
-        thrWindow = juce::jlimit(16, 1024, (int) std::round(frames));
+        thrWindow = juce::jlimit(16, maxThresholdWindow, (int) std::round(frames));
+        recentZ.setWindow(thrWindow);
     }
 
 private:
-    void computeFrame()
+    void computeFrame(const SpectrumFrame& frame)
     {
-        const int fftSize = 1 << fftOrder;
-        auto* buf = stftInput.getWritePointer(0);
-        for (int i = 0; i < fftSize; ++i)
-        {
-            int idx = (fifoWrite + fifoBuffer.size() - fftSize + i) % fifoBuffer.size();
-            buf[i] = fifoBuffer[idx] * window[i];
-        }
-
-        tempFFT.resize((size_t) fftSize * 2);
-        std::fill(tempFFT.begin(), tempFFT.end(), 0.0f);
-        memcpy(tempFFT.data(), buf, sizeof(float) * (size_t) fftSize);
-        fft.performRealOnlyForwardTransform(tempFFT.data());
-
-        const int bins = fftSize / 2 + 1;
-        // Determine bin range for band-limited flux
-        int startBin = 0;
-        int endBin = bins - 1;
-        if (bandLowHz > 0.0f || std::isfinite(bandHighHz))
-        {
-            const float hzPerBin = (float) sampleRate / (float) fftSize;
-            if (bandLowHz > 0.0f)
-                startBin = juce::jlimit(0, bins - 1, (int) std::ceil(bandLowHz / hzPerBin));
-            if (std::isfinite(bandHighHz))
-                endBin = juce::jlimit(0, bins - 1, (int) std::floor(bandHighHz / hzPerBin));
-        }
-
-        float flux = 0.0f;
-        for (int k = startBin; k <= endBin; ++k)
-        {
-            const float re = tempFFT[(size_t) k * 2];
-            const float im = tempFFT[(size_t) k * 2 + 1];
-            const float mag = std::sqrt(re * re + im * im);
-            // Complex-domain flux: positive increase relative to previous vector orientation
-            const float prevMagK = prevMag[(size_t) k];
-            const float denom = juce::jmax(1.0e-12f, prevMagK);
-            const float dot = re * prevRe[(size_t) k] + im * prevIm[(size_t) k];
-            const float cosDelta = (prevMagK > 1.0e-12f && mag > 1.0e-12f) ? (dot / (mag * prevMagK)) : 1.0f;
-            const float term = mag - prevMagK * cosDelta;
-            const float diff = juce::jmax(0.0f, term);
-            flux += diff;
-            prevMag[(size_t) k] = mag;
-            prevRe[(size_t) k] = re;
-            prevIm[(size_t) k] = im;
-        }
+        // Complex-domain flux: positive increase relative to previous vector orientation
+        const float flux = FluxKernel::complexDomainFlux(frame.re + startBin, frame.im + startBin,
+                                                         prevRe.data(), prevIm.data(), prevMag.data(),
+                                                         (int) prevMag.size());
 
         // Smoothing
         const float alpha = 0.2f;
@@ -146,20 +126,13 @@ private:
         const float z = (smoothed - ewmaMean) / ewmaStd;
 
         // Rolling median + MAD threshold on z-scores
-        recentZ.push_back(z);
-        if (recentZ.size() > (size_t) thrWindow)
-            recentZ.pop_front();
+        recentZ.push(z);
 
         float threshold = 2.5f; // default if not enough history
         if (recentZ.size() >= 9)
         {
-            std::vector<float> tmp(recentZ.begin(), recentZ.end());
-            const size_t mid = tmp.size() / 2;
-            std::nth_element(tmp.begin(), tmp.begin() + (long) mid, tmp.end());
-            const float med = tmp[mid];
-            for (auto& v : tmp) v = std::abs(v - med);
-            std::nth_element(tmp.begin(), tmp.begin() + (long) mid, tmp.end());
-            const float mad = tmp[mid] + 1.0e-6f;
+            const float med = recentZ.median();
+            const float mad = recentZ.mad(med) + 1.0e-6f;
             threshold = med + thrK * 1.4826f * mad; // 1.4826 ~ Gaussian MAD->sigma
         }
 
@@ -187,41 +160,29 @@ private:
                 const double timeSec = ((frameIndex * (double) hopSize) + centerCorrection) / (double) sampleRate;
                 // Refractory: ignore onsets within a short window
                 // Tempo-adaptive refractory: if we have an estimate, expand refractory up to 20% of period
-                const double adaptiveRef = juce::jlimit(0.05, 0.15, refractorySec);
+                const double adaptiveRef = juce::jlimit(0.05, 0.15, refractorySec.load(std::memory_order_relaxed));
                 const double minGapSec = adaptiveRef;
                 const bool allow = (!hasLastOnsetSec || (timeSec - lastOnsetSec) >= minGapSec);
                 if (allow)
                 {
-                    {
-                        std::lock_guard<std::mutex> lock(queueMutex);
-                        onsetTimesSec.push_back(timeSec);
-                    }
+                    onsetQueue.push(timeSec);
                     lastOnsetSec = timeSec;
                     hasLastOnsetSec = true;
                 }
             }
         }
 
-        {
-            std::lock_guard<std::mutex> lock(queueMutex);
-            newFluxFrames.push_back(z);
-        }
+        fluxQueue.push(z);
         ++framesProcessed;
     }
 
     int sampleRate;
-    int fftOrder;
-    juce::dsp::FFT fft;
-    juce::AudioBuffer<float> stftInput;
-    std::vector<float> tempFFT;
-    std::vector<float> window;
-    std::vector<float> prevMag;
-    std::vector<float> prevRe;
-    std::vector<float> prevIm;
-    std::vector<float> fifoBuffer;
-    size_t fifoWrite { 0 };
+    int fftSize;
+    std::unique_ptr<StftFrontEnd> ownFrontEnd;
+    AlignedFloatVector prevMag;
+    AlignedFloatVector prevRe;
+    AlignedFloatVector prevIm;
     int hopSize { 256 };
-    int samplesSinceHop { 0 };
     // Smoothed flux stream
     bool hasLastSmoothed { false };
     float lastSmoothed { 0.0f };
@@ -231,18 +192,21 @@ private:
     float ewmaVar { 0.0f };
     float prev2 { 0.0f }, prev1 { 0.0f }, curr { 0.0f };
     uint64_t framesProcessed { 0 };
-    std::vector<float> newFluxFrames;
-    std::vector<double> onsetTimesSec;
-    std::mutex queueMutex;
+    // DSP thread -> consumer handoff; ~20 s of flux at a 5 ms hop
+    SpscQueue<float> fluxQueue { 4096 };
+    SpscQueue<double> onsetQueue { 1024 };
     // Band-limiting
     float bandLowHz { 0.0f };
     float bandHighHz { std::numeric_limits<float>::infinity() };
+    int startBin { 0 };
+    int endBin { 0 };
     // Thresholding state
-    std::deque<float> recentZ;
+    static constexpr int maxThresholdWindow = 4096;
     int thrWindow { 64 };
+    RollingMedianMad recentZ { thrWindow };
     float thrK { 3.0f };
     // Refractory
-    double refractorySec { 0.06 };
+    std::atomic<double> refractorySec { 0.06 };
     double lastOnsetSec { 0.0 };
     bool hasLastOnsetSec { false };
 };
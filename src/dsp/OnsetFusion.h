@@ -0,0 +1,195 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <deque>
+#include <vector>
+
+// Turns the band detectors' output into what tempo and beat tracking see (analysis thread):
+//   flux:   the high-resolution flux of all bands as one stream, each band z-scored against its
+//           own running mean/variance and weighted by its recent onset activity
+//   onsets: both resolutions' onsets clustered within a short coincidence window, merged
+//           within a fraction of the beat period and kept if enough bands support them
+class OnsetFusion {
+public:
+    static constexpr int numBands = 5;
+    using BandFlux = std::array<std::vector<float>, numBands>;
+    using BandOnsets = std::array<std::vector<double>, numBands>;
+
+    void reset()
+    {
+        for (size_t b = 0; b < (size_t) numBands; ++b)
+        {
+            pendingFlux[b].clear();
+            ewmaInit[b] = false;
+            recentBandOnsets[b].clear();
+        }
+    }
+
+    // Queues each band's new flux frames. fused gets one frame for every frame all bands have
+    // delivered, and stays empty until then.
+    void fuseFlux(const BandFlux& newFlux, std::vector<float>& fused)
+    {
+        fused.clear();
+        size_t minAvail = SIZE_MAX;
+        for (size_t b = 0; b < (size_t) numBands; ++b)
+        {
+            if (!newFlux[b].empty())
+                pendingFlux[b].insert(pendingFlux[b].end(), newFlux[b].begin(), newFlux[b].end());
+            minAvail = juce::jmin(minAvail, pendingFlux[b].size());
+        }
+        if (minAvail == 0)
+            return;
+
+        fused.assign(minAvail, 0.0f);
+        double totalW = 0.0;
+        const auto weights = bandWeights(totalW);
+        for (size_t b = 0; b < (size_t) numBands; ++b)
+        {
+            auto& v = pendingFlux[b];
+            const float wnorm = (float) (weights[b] / totalW);
+            float mean = ewmaMean[b];
+            float var  = ewmaVar[b];
+            bool  init = ewmaInit[b];
+            const float gamma = 0.03f;
+            for (size_t i = 0; i < minAvail; ++i)
+            {
+                const float x = v[i];
+                if (!init)
+                {
+                    mean = x;
+                    var  = 0.0f;
+                    init = true;
+                }
+                else
+                {
+                    const float dm = x - mean;
+                    mean += gamma * dm;
+                    var = (1.0f - gamma) * (var + gamma * dm * dm);
+                }
+                const float stddev = std::sqrt(juce::jmax(var, 1.0e-6f));
+                const float z = (x - mean) / stddev;
+                fused[i] += z * wnorm;
+            }
+            ewmaMean[b] = mean;
+            ewmaVar[b]  = var;
+            ewmaInit[b] = init;
+            v.erase(v.begin(), v.begin() + (long) minAvail);
+        }
+    }
+
+    // merged holds this tick's onsets of every band at both resolutions and is replaced by the
+    // ones that survive, sorted. bandOnsets are the high-resolution onsets per band, sorted;
+    // they decide the band support and feed the band weights. bpm (or -1) sets the merge window.
+    void gateOnsets(const BandOnsets& bandOnsets, std::vector<double>& merged, double bpm)
+    {
+        if (merged.empty())
+            return;
+
+        std::sort(merged.begin(), merged.end());
+        const double fixedWin = juce::jlimit(0.008, 0.030, coincidenceWindowSec);
+        stage1.clear();
+        for (size_t i = 0; i < merged.size(); )
+        {
+            double t0 = merged[i];
+            double sum = 0.0; int count = 0;
+            size_t j = i;
+            while (j < merged.size() && (merged[j] - t0) <= fixedWin)
+            {
+                sum += merged[j];
+                ++count; ++j;
+            }
+            stage1.push_back(sum / juce::jmax(1, count));
+            i = j;
+        }
+        double per = bpm > 0.0 ? (60.0 / bpm) : 0.5;
+        const double mergeWindow = juce::jlimit(0.01, 0.06, 0.10 * per);
+        merged.clear();
+        for (double t : stage1)
+        {
+            if (merged.empty() || std::abs(t - merged.back()) > mergeWindow)
+                merged.push_back(t);
+        }
+
+        double totalW = 0.0;
+        const auto weights = bandWeights(totalW);
+        stage1.swap(merged);
+        merged.clear();
+        for (double t : stage1)
+        {
+            int bands = 0;
+            double wsum = 0.0;
+            for (size_t b = 0; b < (size_t) numBands; ++b)
+            {
+                const auto& bo = bandOnsets[b];
+                auto it = std::lower_bound(bo.begin(), bo.end(), t - fixedWin);
+                if (it != bo.end() && std::abs(*it - t) <= fixedWin)
+                {
+                    ++bands;
+                    wsum += weights[b];
+                }
+            }
+            const double normalizedSupport = wsum / totalW;
+            if (bands >= juce::jmax(1, minBandsForOnset) || normalizedSupport >= 0.6)
+                merged.push_back(t);
+        }
+
+        if (!merged.empty())
+        {
+            const double latest = merged.back();
+            for (size_t b = 0; b < (size_t) numBands; ++b)
+            {
+                auto& q = recentBandOnsets[b];
+                for (double t : bandOnsets[b])
+                {
+                    q.push_back(t);
+                    while (!q.empty() && (latest - q.front()) > bandOnsetWindowSec) q.pop_front();
+                }
+            }
+        }
+    }
+
+    // Forgets band onsets older than bandOnsetWindowSec before nowSec; call every tick, as
+    // gateOnsets only prunes when an onset gets through and silence would leave them stale
+    void decay(double nowSec)
+    {
+        for (auto& q : recentBandOnsets)
+            while (!q.empty() && (nowSec - q.front()) > bandOnsetWindowSec) q.pop_front();
+    }
+
+    // 0..1 onset activity of a band over the last bandOnsetWindowSec
+    float getBandActivity(size_t band) const
+    {
+        const double wnd = juce::jmax(0.5, bandOnsetWindowSec);
+        return (float) (1.0 - std::exp(-(double) recentBandOnsets[band].size() / wnd));
+    }
+
+private:
+    // 0.5 for a silent band up to 1.0 for a busy one; totalW is their sum (never zero)
+    std::array<double, numBands> bandWeights(double& totalW) const
+    {
+        std::array<double, numBands> weights {};
+        totalW = 0.0;
+        for (size_t b = 0; b < (size_t) numBands; ++b)
+        {
+            const double wnd = juce::jmax(0.5, bandOnsetWindowSec);
+            const double rate = recentBandOnsets[b].size() / wnd;
+            weights[b] = 0.5 + 0.5 * (1.0 - std::exp(-rate));
+            totalW += weights[b];
+        }
+        if (totalW <= 1.0e-6) totalW = 1.0;
+        return weights;
+    }
+
+    std::array<std::deque<double>, numBands> recentBandOnsets;
+    double bandOnsetWindowSec { 4.0 };
+    std::array<std::vector<float>, numBands> pendingFlux;
+    std::array<float, numBands> ewmaMean {};
+    std::array<float, numBands> ewmaVar {};
+    std::array<bool, numBands> ewmaInit {};
+    double coincidenceWindowSec { 0.015 }; // small fixed window for multi-band coincidence
+    int minBandsForOnset { 2 };
+    std::vector<double> stage1;
+};
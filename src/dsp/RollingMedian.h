@@ -0,0 +1,246 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <vector>
+#include <cstdint>
+#include <cmath>
+#include <limits>
+
+// Sliding-window median and MAD (median absolute deviation) over the last N values.
+// Values live in an order-statistic treap backed by a preallocated node pool, so push/evict
+// are O(log n), rank queries are O(log n) and the MAD query is O(log^2 n) with no allocation.
+// Results match nth_element on a copy of the window at index size()/2 (upper median).
+class RollingMedianMad {
+public:
+    explicit RollingMedianMad(int window = 64) { setWindow(window); }
+
+    // Change the window length; grows storage if needed (not real-time safe when growing),
+    // evicts the oldest values when shrinking.
+    void setWindow(int newWindow)
+    {
+        newWindow = juce::jmax(1, newWindow);
+        if (newWindow > capacity)
+            grow(newWindow);
+        window = newWindow;
+        while (count > window)
+            evictOldest();
+    }
+
+    void push(float v)
+    {
+        if (count == window)
+            evictOldest();
+        history[(size_t) ((head + count) % capacity)] = v;
+        ++count;
+        root = insert(root, allocNode(v));
+    }
+
+    void clear()
+    {
+        root = nil;
+        head = 0;
+        count = 0;
+        freeList.clear();
+        for (int i = capacity - 1; i >= 0; --i)
+            freeList.push_back(i);
+    }
+
+    int size() const { return count; }
+
+    float median() const
+    {
+        jassert(count > 0);
+        return kth(count / 2);
+    }
+
+    // Median of |x - med| over the window
+    float mad(float med) const
+    {
+        jassert(count > 0);
+        // With s sorted and m = count/2 (so s[m] == med when med == median()):
+        //   A_i = med - s[m-1-i], i in [0, m)           (ascending)
+        //   B_j = s[m+j] - med,   j in [0, count - m)   (ascending)
+        // MAD is the m-th smallest (0-based) element of A merged with B.
+        const int m = count / 2;
+        const int lenA = m;
+        const int lenB = count - m;
+        const int take = m + 1;
+        auto A = [&](int i) { return med - kth(m - 1 - i); };
+        auto B = [&](int j) { return kth(m + j) - med; };
+
+        int lo = juce::jmax(0, take - lenB);
+        int hi = juce::jmin(take, lenA);
+        while (lo <= hi)
+        {
+            const int a = (lo + hi) / 2;
+            const int b = take - a;
+            if (a < lenA && b > 0 && B(b - 1) > A(a))
+                lo = a + 1;
+            else if (a > 0 && b < lenB && A(a - 1) > B(b))
+                hi = a - 1;
+            else
+            {
+                float result = -std::numeric_limits<float>::infinity();
+                if (a > 0) result = juce::jmax(result, A(a - 1));
+                if (b > 0) result = juce::jmax(result, B(b - 1));
+                return result;
+            }
+        }
+        jassertfalse;
+        return 0.0f;
+    }
+
+private:
+    struct Node
+    {
+        float key;
+        uint32_t priority;
+        int left, right;
+        int size;
+    };
+
+    static constexpr int nil = -1;
+
+    int sizeOf(int t) const { return t == nil ? 0 : nodes[(size_t) t].size; }
+    void update(int t) { nodes[(size_t) t].size = 1 + sizeOf(nodes[(size_t) t].left) + sizeOf(nodes[(size_t) t].right); }
+
+    uint32_t nextPriority()
+    {
+        // xorshift32: cheap, deterministic priorities for the treap
+        rng ^= rng << 13; rng ^= rng >> 17; rng ^= rng << 5;
+        return rng;
+    }
+
+    int allocNode(float key)
+    {
+        jassert(!freeList.empty());
+        const int idx = freeList.back();
+        freeList.pop_back();
+        nodes[(size_t) idx] = Node { key, nextPriority(), nil, nil, 1 };
+        return idx;
+    }
+
+    // Split t into keys < key (l) and keys >= key (r)
+    void split(int t, float key, int& l, int& r)
+    {
+        if (t == nil) { l = r = nil; return; }
+        auto& n = nodes[(size_t) t];
+        if (n.key < key)
+        {
+            split(n.right, key, n.right, r);
+            l = t;
+        }
+        else
+        {
+            split(n.left, key, l, n.left);
+            r = t;
+        }
+        update(t);
+    }
+
+    // Split t into its first k nodes in order (l) and the rest (r)
+    void splitBySize(int t, int k, int& l, int& r)
+    {
+        if (t == nil) { l = r = nil; return; }
+        auto& n = nodes[(size_t) t];
+        if (sizeOf(n.left) < k)
+        {
+            splitBySize(n.right, k - sizeOf(n.left) - 1, n.right, r);
+            l = t;
+        }
+        else
+        {
+            splitBySize(n.left, k, l, n.left);
+            r = t;
+        }
+        update(t);
+    }
+
+    int merge(int l, int r)
+    {
+        if (l == nil) return r;
+        if (r == nil) return l;
+        if (nodes[(size_t) l].priority > nodes[(size_t) r].priority)
+        {
+            nodes[(size_t) l].right = merge(nodes[(size_t) l].right, r);
+            update(l);
+            return l;
+        }
+        nodes[(size_t) r].left = merge(l, nodes[(size_t) r].left);
+        update(r);
+        return r;
+    }
+
+    int insert(int t, int node)
+    {
+        int l = nil, r = nil;
+        split(t, nodes[(size_t) node].key, l, r);
+        return merge(merge(l, node), r);
+    }
+
+    int erase(int t, float key)
+    {
+        int l = nil, r = nil, m = nil, rest = nil;
+        split(t, key, l, r);          // r holds keys >= key; its smallest equals key
+        splitBySize(r, 1, m, rest);
+        jassert(m != nil && nodes[(size_t) m].key == key);
+        if (m != nil)
+            freeList.push_back(m);
+        return merge(l, rest);
+    }
+
+    float kth(int k) const
+    {
+        int t = root;
+        while (t != nil)
+        {
+            const auto& n = nodes[(size_t) t];
+            const int ls = sizeOf(n.left);
+            if (k < ls)
+                t = n.left;
+            else if (k == ls)
+                return n.key;
+            else
+            {
+                k -= ls + 1;
+                t = n.right;
+            }
+        }
+        jassertfalse;
+        return 0.0f;
+    }
+
+    void evictOldest()
+    {
+        if (count == 0) return;
+        const float oldest = history[(size_t) head];
+        head = (head + 1) % capacity;
+        --count;
+        root = erase(root, oldest);
+    }
+
+    void grow(int newCapacity)
+    {
+        std::vector<float> reordered((size_t) newCapacity, 0.0f);
+        for (int i = 0; i < count; ++i)
+            reordered[(size_t) i] = history[(size_t) ((head + i) % capacity)];
+        history.swap(reordered);
+        head = 0;
+
+        nodes.resize((size_t) newCapacity);
+        freeList.reserve((size_t) newCapacity);
+        for (int i = newCapacity - 1; i >= capacity; --i)
+            freeList.push_back(i);
+        capacity = newCapacity;
+    }
+
+    std::vector<Node> nodes;
+    std::vector<int> freeList;
+    std::vector<float> history; // insertion order ring, for eviction
+    int capacity { 0 };
+    int window { 1 };
+    int head { 0 };
+    int count { 0 };
+    int root { nil };
+    uint32_t rng { 0x9E3779B9u };
+};
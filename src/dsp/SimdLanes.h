@@ -0,0 +1,142 @@
+#pragma once
+
+#include <algorithm>
+#include <utility>
+
+#if defined(__AVX2__)
+ #include <immintrin.h>
+ #define MASTER_TEMPO_LANES_AVX2 1
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+ #include <emmintrin.h>
+ #define MASTER_TEMPO_LANES_SSE2 1
+#elif defined(__aarch64__) || defined(_M_ARM64)
+ #include <arm_neon.h>
+ #define MASTER_TEMPO_LANES_NEON 1
+#endif
+
+// Eight float lanes: one AVX register, or two SSE2/NEON registers. load/store need 32-byte
+// aligned pointers, the Unaligned forms any.
+namespace SimdLanes
+{
+#if MASTER_TEMPO_LANES_AVX2
+    struct F8 { __m256 v; };
+    inline F8 load(const float* p) noexcept            { return { _mm256_load_ps(p) }; }
+    inline F8 loadUnaligned(const float* p) noexcept   { return { _mm256_loadu_ps(p) }; }
+    inline void store(float* p, F8 a) noexcept         { _mm256_store_ps(p, a.v); }
+    inline void storeUnaligned(float* p, F8 a) noexcept { _mm256_storeu_ps(p, a.v); }
+    inline F8 set1(float x) noexcept                   { return { _mm256_set1_ps(x) }; }
+    inline F8 add(F8 a, F8 b) noexcept                 { return { _mm256_add_ps(a.v, b.v) }; }
+    inline F8 sub(F8 a, F8 b) noexcept                 { return { _mm256_sub_ps(a.v, b.v) }; }
+    inline F8 mul(F8 a, F8 b) noexcept                 { return { _mm256_mul_ps(a.v, b.v) }; }
+    // (x, a0, a1, ..., a6): moves every lane up by one and feeds x into lane 0
+    inline F8 shiftIn(F8 a, float x) noexcept
+    {
+        const __m256 up = _mm256_permutevar8x32_ps(a.v, _mm256_setr_epi32(0, 0, 1, 2, 3, 4, 5, 6));
+        return { _mm256_blend_ps(up, _mm256_set1_ps(x), 1) };
+    }
+    // 8x8 transpose: rows of eight lanes per sample become rows of eight samples per lane
+    inline void transpose(F8* r) noexcept
+    {
+        __m256 t[8], u[8];
+        for (int i = 0; i < 8; i += 2)
+        {
+            t[i] = _mm256_unpacklo_ps(r[i].v, r[i + 1].v);
+            t[i + 1] = _mm256_unpackhi_ps(r[i].v, r[i + 1].v);
+        }
+        for (int i = 0; i < 8; i += 4)
+        {
+            u[i]     = _mm256_shuffle_ps(t[i], t[i + 2], _MM_SHUFFLE(1, 0, 1, 0));
+            u[i + 1] = _mm256_shuffle_ps(t[i], t[i + 2], _MM_SHUFFLE(3, 2, 3, 2));
+            u[i + 2] = _mm256_shuffle_ps(t[i + 1], t[i + 3], _MM_SHUFFLE(1, 0, 1, 0));
+            u[i + 3] = _mm256_shuffle_ps(t[i + 1], t[i + 3], _MM_SHUFFLE(3, 2, 3, 2));
+        }
+        for (int i = 0; i < 4; ++i)
+        {
+            r[i].v = _mm256_permute2f128_ps(u[i], u[i + 4], 0x20);
+            r[i + 4].v = _mm256_permute2f128_ps(u[i], u[i + 4], 0x31);
+        }
+    }
+#elif MASTER_TEMPO_LANES_SSE2
+    struct F8 { __m128 lo, hi; };
+    inline F8 load(const float* p) noexcept            { return { _mm_load_ps(p), _mm_load_ps(p + 4) }; }
+    inline F8 loadUnaligned(const float* p) noexcept   { return { _mm_loadu_ps(p), _mm_loadu_ps(p + 4) }; }
+    inline void store(float* p, F8 a) noexcept         { _mm_store_ps(p, a.lo); _mm_store_ps(p + 4, a.hi); }
+    inline void storeUnaligned(float* p, F8 a) noexcept { _mm_storeu_ps(p, a.lo); _mm_storeu_ps(p + 4, a.hi); }
+    inline F8 set1(float x) noexcept                   { return { _mm_set1_ps(x), _mm_set1_ps(x) }; }
+    inline F8 add(F8 a, F8 b) noexcept                 { return { _mm_add_ps(a.lo, b.lo), _mm_add_ps(a.hi, b.hi) }; }
+    inline F8 sub(F8 a, F8 b) noexcept                 { return { _mm_sub_ps(a.lo, b.lo), _mm_sub_ps(a.hi, b.hi) }; }
+    inline F8 mul(F8 a, F8 b) noexcept                 { return { _mm_mul_ps(a.lo, b.lo), _mm_mul_ps(a.hi, b.hi) }; }
+    inline F8 shiftIn(F8 a, float x) noexcept
+    {
+        const __m128 xl = _mm_shuffle_ps(_mm_set1_ps(x), a.lo, _MM_SHUFFLE(0, 0, 0, 0)); // x x a0 a0
+        const __m128 lh = _mm_shuffle_ps(a.lo, a.hi, _MM_SHUFFLE(0, 0, 3, 3));           // a3 a3 a4 a4
+        return { _mm_shuffle_ps(xl, a.lo, _MM_SHUFFLE(2, 1, 2, 0)),                        // x a0 a1 a2
+                 _mm_shuffle_ps(lh, a.hi, _MM_SHUFFLE(2, 1, 2, 0)) };                      // a3 a4 a5 a6
+    }
+    // 8x8 transpose as four 4x4 blocks
+    inline void transpose(F8* r) noexcept
+    {
+        _MM_TRANSPOSE4_PS(r[0].lo, r[1].lo, r[2].lo, r[3].lo);
+        _MM_TRANSPOSE4_PS(r[4].lo, r[5].lo, r[6].lo, r[7].lo);
+        _MM_TRANSPOSE4_PS(r[0].hi, r[1].hi, r[2].hi, r[3].hi);
+        _MM_TRANSPOSE4_PS(r[4].hi, r[5].hi, r[6].hi, r[7].hi);
+        for (int i = 0; i < 4; ++i)
+            std::swap(r[i].hi, r[i + 4].lo);
+    }
+#elif MASTER_TEMPO_LANES_NEON
+    struct F8 { float32x4_t lo, hi; };
+    inline F8 load(const float* p) noexcept            { return { vld1q_f32(p), vld1q_f32(p + 4) }; }
+    inline F8 loadUnaligned(const float* p) noexcept   { return { vld1q_f32(p), vld1q_f32(p + 4) }; }
+    inline void store(float* p, F8 a) noexcept         { vst1q_f32(p, a.lo); vst1q_f32(p + 4, a.hi); }
+    inline void storeUnaligned(float* p, F8 a) noexcept { vst1q_f32(p, a.lo); vst1q_f32(p + 4, a.hi); }
+    inline F8 set1(float x) noexcept                   { return { vdupq_n_f32(x), vdupq_n_f32(x) }; }
+    inline F8 add(F8 a, F8 b) noexcept                 { return { vaddq_f32(a.lo, b.lo), vaddq_f32(a.hi, b.hi) }; }
+    inline F8 sub(F8 a, F8 b) noexcept                 { return { vsubq_f32(a.lo, b.lo), vsubq_f32(a.hi, b.hi) }; }
+    inline F8 mul(F8 a, F8 b) noexcept                 { return { vmulq_f32(a.lo, b.lo), vmulq_f32(a.hi, b.hi) }; }
+    inline F8 shiftIn(F8 a, float x) noexcept
+    {
+        return { vextq_f32(vdupq_n_f32(x), a.lo, 3), vextq_f32(a.lo, a.hi, 3) };
+    }
+    inline void transpose4(float32x4_t& a, float32x4_t& b, float32x4_t& c, float32x4_t& d) noexcept
+    {
+        const float32x4x2_t ab = vtrnq_f32(a, b); // a0 b0 a2 b2 | a1 b1 a3 b3
+        const float32x4x2_t cd = vtrnq_f32(c, d);
+        a = vcombine_f32(vget_low_f32(ab.val[0]), vget_low_f32(cd.val[0]));
+        b = vcombine_f32(vget_low_f32(ab.val[1]), vget_low_f32(cd.val[1]));
+        c = vcombine_f32(vget_high_f32(ab.val[0]), vget_high_f32(cd.val[0]));
+        d = vcombine_f32(vget_high_f32(ab.val[1]), vget_high_f32(cd.val[1]));
+    }
+    // 8x8 transpose as four 4x4 blocks
+    inline void transpose(F8* r) noexcept
+    {
+        transpose4(r[0].lo, r[1].lo, r[2].lo, r[3].lo);
+        transpose4(r[4].lo, r[5].lo, r[6].lo, r[7].lo);
+        transpose4(r[0].hi, r[1].hi, r[2].hi, r[3].hi);
+        transpose4(r[4].hi, r[5].hi, r[6].hi, r[7].hi);
+        for (int i = 0; i < 4; ++i)
+            std::swap(r[i].hi, r[i + 4].lo);
+    }
+#else
+    struct F8 { float v[8]; };
+    inline F8 load(const float* p) noexcept            { F8 r; std::copy(p, p + 8, r.v); return r; }
+    inline F8 loadUnaligned(const float* p) noexcept   { return load(p); }
+    inline void store(float* p, F8 a) noexcept         { std::copy(a.v, a.v + 8, p); }
+    inline void storeUnaligned(float* p, F8 a) noexcept { std::copy(a.v, a.v + 8, p); }
+    inline F8 set1(float x) noexcept                   { F8 r; std::fill(r.v, r.v + 8, x); return r; }
+    inline F8 add(F8 a, F8 b) noexcept                 { for (int i = 0; i < 8; ++i) a.v[i] += b.v[i]; return a; }
+    inline F8 sub(F8 a, F8 b) noexcept                 { for (int i = 0; i < 8; ++i) a.v[i] -= b.v[i]; return a; }
+    inline F8 mul(F8 a, F8 b) noexcept                 { for (int i = 0; i < 8; ++i) a.v[i] *= b.v[i]; return a; }
+    inline F8 shiftIn(F8 a, float x) noexcept
+    {
+        for (int i = 7; i > 0; --i) a.v[i] = a.v[i - 1];
+        a.v[0] = x;
+        return a;
+    }
+    inline void transpose(F8* r) noexcept
+    {
+        for (int i = 0; i < 8; ++i)
+            for (int j = i + 1; j < 8; ++j)
+                std::swap(r[i].v[j], r[j].v[i]);
+    }
+#endif
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <atomic>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+// Latest-value publication from one writer thread to any number of reader threads.
+// Seqlock over a payload stored as relaxed atomic words: the writer never waits, readers
+// never block the writer and simply retry if they raced with a publish.
+template <typename T>
+class SeqlockSnapshot {
+    static_assert(std::is_trivially_copyable<T>::value, "snapshot payload must be trivially copyable");
+    static constexpr size_t numWords = (sizeof(T) + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+
+public:
+    SeqlockSnapshot() { publish(T {}); sequence.store(0, std::memory_order_relaxed); }
+
+    // Writer side (single thread)
+    void publish(const T& value) noexcept
+    {
+        uint64_t words[numWords] {};
+        std::memcpy(words, &value, sizeof(T));
+        const uint64_t s = sequence.load(std::memory_order_relaxed);
+        sequence.store(s + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        for (size_t i = 0; i < numWords; ++i)
+            payload[i].store(words[i], std::memory_order_relaxed);
+        sequence.store(s + 2, std::memory_order_release);
+    }
+
+    // Reader side (any thread); returns the most recently published value
+    T read() const noexcept
+    {
+        uint64_t words[numWords];
+        for (;;)
+        {
+            const uint64_t s1 = sequence.load(std::memory_order_acquire);
+            if ((s1 & 1) != 0) continue;
+            for (size_t i = 0; i < numWords; ++i)
+                words[i] = payload[i].load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (sequence.load(std::memory_order_relaxed) == s1)
+                break;
+        }
+        T value;
+        std::memcpy(&value, words, sizeof(T));
+        return value;
+    }
+
+    // Number of publishes so far; lets readers skip work when nothing changed
+    uint64_t getVersion() const noexcept { return sequence.load(std::memory_order_acquire) / 2; }
+
+private:
+    std::atomic<uint64_t> sequence { 0 };
+    std::array<std::atomic<uint64_t>, numWords> payload {};
+};
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <atomic>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <algorithm>
+
+// Fixed-capacity, wait-free single-producer/single-consumer ring queue.
+// push() is called from exactly one thread and drain() from exactly one other thread.
+// When full, push() drops the value and bumps an overflow counter instead of blocking.
+template <typename T>
+class SpscQueue {
+public:
+    explicit SpscQueue(size_t minCapacity)
+    {
+        size_t cap = 1;
+        while (cap < minCapacity) cap <<= 1;
+        buffer.resize(cap);
+        mask = cap - 1;
+    }
+
+    // Producer side
+    bool push(const T& value) noexcept
+    {
+        const size_t w = writePos.load(std::memory_order_relaxed);
+        const size_t r = readPos.load(std::memory_order_acquire);
+        if (w - r > mask)
+        {
+            overflows.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        buffer[w & mask] = value;
+        writePos.store(w + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer side: copies up to maxCount items into dest, returns the number copied
+    size_t drain(T* dest, size_t maxCount) noexcept
+    {
+        const size_t r = readPos.load(std::memory_order_relaxed);
+        const size_t w = writePos.load(std::memory_order_acquire);
+        const size_t n = std::min(w - r, maxCount);
+        if (n == 0) return 0;
+        const size_t start = r & mask;
+        const size_t first = std::min(n, buffer.size() - start);
+        std::copy_n(buffer.data() + start, first, dest);
+        std::copy_n(buffer.data(), n - first, dest + first);
+        readPos.store(r + n, std::memory_order_release);
+        return n;
+    }
+
+    // Approximate when called from neither side
+    size_t getNumReady() const noexcept
+    {
+        return writePos.load(std::memory_order_acquire) - readPos.load(std::memory_order_acquire);
+    }
+
+    size_t getCapacity() const noexcept { return buffer.size(); }
+    uint64_t getOverflowCount() const noexcept { return overflows.load(std::memory_order_relaxed); }
+
+private:
+    std::vector<T> buffer;
+    size_t mask { 0 };
+    alignas(64) std::atomic<size_t> writePos { 0 };
+    alignas(64) std::atomic<size_t> readPos { 0 };
+    alignas(64) std::atomic<uint64_t> overflows { 0 };
+};
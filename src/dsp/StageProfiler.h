@@ -0,0 +1,325 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <array>
+#include <atomic>
+#include <iomanip>
+#include <memory>
+#include <ostream>
+#include <vector>
+
+// Latency histogram with HDR-style log-linear buckets over nanoseconds: values below subCount
+// get a bucket each, every power of two above is split into subCount buckets, so a value is
+// known to within 1/subCount (6%) up to 2^maxExponent ns (~68 s; longer ones land in the top
+// bucket). Recording is a handful of relaxed atomic adds, wait-free and safe from any thread;
+// readers copy the counts without stopping the writers.
+class LatencyHistogram {
+public:
+    static constexpr int subBits = 4;
+    static constexpr int subCount = 1 << subBits;
+    static constexpr int maxExponent = 35;
+    static constexpr int numBuckets = subCount + (maxExponent - subBits + 1) * subCount;
+
+    struct Counts
+    {
+        std::array<uint64_t, numBuckets> buckets {};
+        uint64_t sumNs { 0 };
+        uint64_t maxNs { 0 };
+    };
+
+    struct Summary
+    {
+        uint64_t count { 0 };
+        double meanUs { 0.0 };
+        double p50Us { 0.0 };
+        double p90Us { 0.0 };
+        double p99Us { 0.0 };
+        double p999Us { 0.0 };
+        double maxUs { 0.0 };
+        double totalMs { 0.0 };
+    };
+
+    void record(uint64_t ns) noexcept
+    {
+        buckets[(size_t) bucketFor(ns)].fetch_add(1, std::memory_order_relaxed);
+        sumNs.fetch_add(ns, std::memory_order_relaxed);
+        uint64_t m = maxNs.load(std::memory_order_relaxed);
+        while (ns > m && !maxNs.compare_exchange_weak(m, ns, std::memory_order_relaxed)) {}
+    }
+
+    // Values recorded while this runs may show up in the buckets but not yet in the sum
+    void read(Counts& out) const noexcept
+    {
+        for (size_t i = 0; i < out.buckets.size(); ++i)
+            out.buckets[i] = buckets[i].load(std::memory_order_relaxed);
+        out.sumNs = sumNs.load(std::memory_order_relaxed);
+        out.maxNs = maxNs.load(std::memory_order_relaxed);
+    }
+
+    // Not atomic as a whole: values recorded meanwhile may be partly kept
+    void reset() noexcept
+    {
+        for (auto& b : buckets)
+            b.store(0, std::memory_order_relaxed);
+        sumNs.store(0, std::memory_order_relaxed);
+        maxNs.store(0, std::memory_order_relaxed);
+    }
+
+    // Of now, or of what was recorded between since and now. Percentiles are bucket midpoints;
+    // an interval's max is its highest bucket's upper edge.
+    static Summary summarise(const Counts& now, const Counts* since = nullptr) noexcept
+    {
+        Summary s;
+        uint64_t total = 0;
+        for (int i = 0; i < numBuckets; ++i)
+            total += delta(now, since, i);
+        if (total == 0)
+            return s;
+
+        s.count = total;
+        const uint64_t sum = since != nullptr && now.sumNs >= since->sumNs ? now.sumNs - since->sumNs : now.sumNs;
+        s.meanUs = (double) sum / (double) total * 0.001;
+        s.totalMs = (double) sum * 1.0e-6;
+
+        const std::array<double, 4> quantiles { 0.50, 0.90, 0.99, 0.999 };
+        std::array<double*, 4> outputs { &s.p50Us, &s.p90Us, &s.p99Us, &s.p999Us };
+        size_t q = 0;
+        uint64_t seen = 0;
+        int highest = 0;
+        for (int i = 0; i < numBuckets; ++i)
+        {
+            const uint64_t n = delta(now, since, i);
+            if (n == 0)
+                continue;
+            seen += n;
+            highest = i;
+            while (q < quantiles.size() && (double) seen >= quantiles[q] * (double) total)
+                *outputs[q++] = 0.001 * ((double) bucketLow(i) + 0.5 * (double) bucketWidth(i));
+        }
+        s.maxUs = since == nullptr ? (double) now.maxNs * 0.001
+                                   : 0.001 * (double) (bucketLow(highest) + bucketWidth(highest));
+        return s;
+    }
+
+    static int bucketFor(uint64_t ns) noexcept
+    {
+        if (ns < (uint64_t) subCount)
+            return (int) ns;
+        const int exponent = highestBit(ns);
+        if (exponent > maxExponent)
+            return numBuckets - 1;
+        const int group = exponent - subBits;
+        return subCount + group * subCount + (int) ((ns >> group) & (uint64_t) (subCount - 1));
+    }
+
+    static uint64_t bucketLow(int index) noexcept
+    {
+        if (index < subCount)
+            return (uint64_t) index;
+        const int group = (index - subCount) / subCount;
+        const int sub = (index - subCount) % subCount;
+        return (uint64_t) (subCount + sub) << group;
+    }
+
+    static uint64_t bucketWidth(int index) noexcept
+    {
+        return index < subCount ? 1 : (uint64_t) 1 << ((index - subCount) / subCount);
+    }
+
+private:
+    static int highestBit(uint64_t v) noexcept
+    {
+        const auto high = (juce::uint32) (v >> 32);
+        return high != 0 ? 32 + juce::findHighestSetBit(high) : juce::findHighestSetBit((juce::uint32) v);
+    }
+
+    static uint64_t delta(const Counts& now, const Counts* since, int i) noexcept
+    {
+        // A bucket below its earlier count was reset in between: count from the reset
+        const uint64_t before = since != nullptr ? since->buckets[(size_t) i] : 0;
+        return now.buckets[(size_t) i] >= before ? now.buckets[(size_t) i] - before : now.buckets[(size_t) i];
+    }
+
+    std::array<std::atomic<uint64_t>, numBuckets> buckets {};
+    std::atomic<uint64_t> sumNs { 0 };
+    std::atomic<uint64_t> maxNs { 0 };
+};
+
+// Per-stage latency histograms and call counts for one AnalysisPipeline, cheap enough to stay
+// on: a stage costs two high-resolution clock reads and a LatencyHistogram::record(). Stages
+// are timed with ScopedTimer on whichever thread runs them. load_% is a stage's total time
+// over the wall time it was observed for, so 100% is one core kept busy.
+class StageProfiler {
+public:
+    enum Stage : int
+    {
+        Capture,            // pushAudio: downmix into the capture FIFO (capture thread)
+        FifoWait,           // DSP thread waiting for and reading a chunk from the FIFO
+        Prefilter,          // HPF/LPF over a chunk
+        StftHi, StftLo,     // one resolution's STFT over a chunk
+        DetectorHi0, DetectorHi1, DetectorHi2, DetectorHi3, DetectorHi4, // a band's frames at 1024 points
+        DetectorLo0, DetectorLo1, DetectorLo2, DetectorLo3, DetectorLo4, // and at 2048
+        FluxFusion,
+        OnsetGating,
+        TempoEstimate,      // TempoEstimator::update on the tempo worker
+        OscSend,            // one tick's (or one scheduled beat's) OSC messages
+        MidiSend,
+        numStages
+    };
+
+    static constexpr int numDetectorBands = 5;
+
+    struct StageSummary : LatencyHistogram::Summary
+    {
+        Stage stage { Capture };
+        double loadPercent { 0.0 };
+    };
+
+    StageProfiler()
+        : histograms(new LatencyHistogram[(size_t) numStages]),
+          intervalCounts(new LatencyHistogram::Counts[(size_t) numStages])
+    {
+        resetTicks.store(juce::Time::getHighResolutionTicks(), std::memory_order_relaxed);
+        intervalTicks = resetTicks.load(std::memory_order_relaxed);
+    }
+
+    static Stage detectorStage(int band, bool hiRes) noexcept
+    {
+        jassert(band >= 0 && band < numDetectorBands);
+        return (Stage) ((hiRes ? DetectorHi0 : DetectorLo0) + band);
+    }
+
+    static const char* getStageName(Stage stage) noexcept
+    {
+        static const char* const names[numStages] {
+            "capture", "fifo_wait", "prefilter", "stft_hi", "stft_lo",
+            "detector_hi_0", "detector_hi_1", "detector_hi_2", "detector_hi_3", "detector_hi_4",
+            "detector_lo_0", "detector_lo_1", "detector_lo_2", "detector_lo_3", "detector_lo_4",
+            "flux_fusion", "onset_gating", "tempo_estimate", "osc_send", "midi_send"
+        };
+        return stage >= 0 && stage < numStages ? names[stage] : "?";
+    }
+
+    void setEnabled(bool shouldRecord) noexcept { enabled.store(shouldRecord, std::memory_order_relaxed); }
+    bool isEnabled() const noexcept             { return enabled.load(std::memory_order_relaxed); }
+
+    void record(Stage stage, juce::int64 elapsedTicks) noexcept
+    {
+        histograms[(size_t) stage].record((uint64_t) ((double) juce::jmax<juce::int64>(0, elapsedTicks) * nanosPerTick()));
+    }
+
+    // Times its scope into a stage; does nothing without a profiler or while it is disabled
+    class ScopedTimer {
+    public:
+        ScopedTimer(StageProfiler* p, Stage s) noexcept
+            : profiler(p != nullptr && p->isEnabled() ? p : nullptr), stage(s),
+              startTicks(profiler != nullptr ? juce::Time::getHighResolutionTicks() : 0) {}
+        ScopedTimer(StageProfiler& p, Stage s) noexcept : ScopedTimer(&p, s) {}
+
+        ~ScopedTimer()
+        {
+            if (profiler != nullptr)
+                profiler->record(stage, juce::Time::getHighResolutionTicks() - startTicks);
+        }
+
+    private:
+        StageProfiler* const profiler;
+        const Stage stage;
+        const juce::int64 startTicks;
+
+        JUCE_DECLARE_NON_COPYABLE (ScopedTimer)
+    };
+
+    // Everything since construction or the last reset() (any thread)
+    StageSummary getSummary(Stage stage) const
+    {
+        LatencyHistogram::Counts counts;
+        histograms[(size_t) stage].read(counts);
+        return makeSummary(stage, LatencyHistogram::summarise(counts), secondsSince(resetTicks.load(std::memory_order_relaxed)));
+    }
+
+    std::vector<StageSummary> getSummaries() const
+    {
+        std::vector<StageSummary> all;
+        all.reserve((size_t) numStages);
+        for (int s = 0; s < numStages; ++s)
+            all.push_back(getSummary((Stage) s));
+        return all;
+    }
+
+    // What was recorded since the previous call, for periodic reports; one caller at a time
+    std::vector<StageSummary> getIntervalSummaries()
+    {
+        const juce::int64 now = juce::Time::getHighResolutionTicks();
+        const double elapsedSec = (double) (now - intervalTicks) / (double) juce::Time::getHighResolutionTicksPerSecond();
+        intervalTicks = now;
+
+        std::vector<StageSummary> all;
+        all.reserve((size_t) numStages);
+        LatencyHistogram::Counts counts;
+        for (int s = 0; s < numStages; ++s)
+        {
+            auto& last = intervalCounts[(size_t) s];
+            histograms[(size_t) s].read(counts);
+            all.push_back(makeSummary((Stage) s, LatencyHistogram::summarise(counts, &last), elapsedSec));
+            last = counts;
+        }
+        return all;
+    }
+
+    // Starts the cumulative summaries over; the next interval then counts from the reset
+    void reset() noexcept
+    {
+        for (int s = 0; s < numStages; ++s)
+            histograms[(size_t) s].reset();
+        resetTicks.store(juce::Time::getHighResolutionTicks(), std::memory_order_relaxed);
+    }
+
+    // One row per stage that ran, with source (file name, stream) as the first column
+    static void writeCsvHeader(std::ostream& out)
+    {
+        out << "source,stage,count,mean_us,p50_us,p90_us,p99_us,p999_us,max_us,total_ms,load_%\n";
+    }
+
+    static void writeCsv(std::ostream& out, const juce::String& source, const std::vector<StageSummary>& stages)
+    {
+        out << std::fixed << std::setprecision(3);
+        for (const auto& s : stages)
+        {
+            if (s.count == 0)
+                continue;
+            out << source << ',' << getStageName(s.stage) << ',' << s.count << ',' << s.meanUs << ',' << s.p50Us << ','
+                << s.p90Us << ',' << s.p99Us << ',' << s.p999Us << ',' << s.maxUs << ',' << s.totalMs << ',' << s.loadPercent << '\n';
+        }
+    }
+
+private:
+    static StageSummary makeSummary(Stage stage, const LatencyHistogram::Summary& summary, double elapsedSec) noexcept
+    {
+        StageSummary s;
+        static_cast<LatencyHistogram::Summary&>(s) = summary;
+        s.stage = stage;
+        s.loadPercent = elapsedSec > 0.0 ? 0.1 * summary.totalMs / elapsedSec : 0.0;
+        return s;
+    }
+
+    static double secondsSince(juce::int64 ticks) noexcept
+    {
+        return (double) (juce::Time::getHighResolutionTicks() - ticks) / (double) juce::Time::getHighResolutionTicksPerSecond();
+    }
+
+    static double nanosPerTick() noexcept
+    {
+        static const double ns = 1.0e9 / (double) juce::Time::getHighResolutionTicksPerSecond();
+        return ns;
+    }
+
+    // On the heap: pipelines also live on the stack (offline analysis)
+    std::unique_ptr<LatencyHistogram[]> histograms;
+    std::unique_ptr<LatencyHistogram::Counts[]> intervalCounts;
+    std::atomic<bool> enabled { true };
+    std::atomic<juce::int64> resetTicks { 0 };
+    juce::int64 intervalTicks { 0 };
+
+    JUCE_DECLARE_NON_COPYABLE (StageProfiler)
+};
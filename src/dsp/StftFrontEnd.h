@@ -0,0 +1,256 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "FluxKernel.h"
+#include "FftPlanPool.h"
+#include <array>
+#include <vector>
+#include <cmath>
+#include <cstring>
+
+// One analysis frame produced by StftFrontEnd.
+// interleaved uses the JUCE real-only FFT layout: (re, im) pairs for bins 0..fftSize/2.
+// re/im hold the same bins deinterleaved into 32-byte aligned arrays for the flux kernel.
+struct SpectrumFrame
+{
+    const float* interleaved { nullptr };
+    const float* re { nullptr };
+    const float* im { nullptr };
+    int fftSize { 0 };
+    int hopSize { 0 };
+    uint64_t frameIndex { 0 };
+};
+
+namespace StftWindows
+{
+    // cos via Taylor series, valid for |x| <= pi; usable in constant expressions
+    constexpr double cosSeries(double x)
+    {
+        double term = 1.0, sum = 1.0;
+        for (int n = 1; n < 20; ++n)
+        {
+            term *= -x * x / (double) ((2 * n - 1) * (2 * n));
+            sum += term;
+        }
+        return sum;
+    }
+
+    // Symmetric Hann window, built with the Chebyshev recurrence
+    // cos((i+1)t) = 2 cos(t) cos(it) - cos((i-1)t) to keep constant evaluation cheap.
+    // Computed in double; differs from DynamicStftStorage's float-computed window by < 4e-7.
+    template <int Size>
+    constexpr std::array<float, Size> makeHann()
+    {
+        std::array<float, Size> w {};
+        const double c1 = cosSeries(2.0 * 3.141592653589793238 / (double) (Size - 1));
+        double prev = c1, curr = 1.0; // cos(-t), cos(0)
+        for (int i = 0; i < Size; ++i)
+        {
+            w[(size_t) i] = (float) (0.5 * (1.0 - curr));
+            const double next = 2.0 * c1 * curr - prev;
+            prev = curr;
+            curr = next;
+        }
+        return w;
+    }
+}
+
+// Buffers for an FFT size chosen at runtime; plan and window come from FftPlanPool
+class DynamicStftStorage {
+public:
+    explicit DynamicStftStorage(int size)
+        : order(FftPlanPool::orderForSize(size)),
+          fft(FftPlanPool::getInstance().getPlan(order)),
+          window(FftPlanPool::getInstance().getHannWindow(size)),
+          history((size_t) size * 2), tempFFT((size_t) size * 2),
+          spectrumRe((size_t) (size / 2 + 1)), spectrumIm((size_t) (size / 2 + 1))
+    {
+        jassert((1 << order) == size);
+    }
+
+    int fftSize() const noexcept { return 1 << order; }
+    const RealFft& getFft() const noexcept { return fft; }
+    const float* getWindow() const noexcept { return window.data(); }
+    float* getHistory() noexcept { return history.data(); }
+    float* getFftBuffer() noexcept { return tempFFT.data(); }
+    float* getRe() noexcept { return spectrumRe.data(); }
+    float* getIm() noexcept { return spectrumIm.data(); }
+
+private:
+    int order;
+    const RealFft& fft;
+    const std::vector<float>& window;
+    std::vector<float> history;
+    AlignedFloatVector tempFFT;
+    AlignedFloatVector spectrumRe;
+    AlignedFloatVector spectrumIm;
+};
+
+// Buffers for an FFT size fixed at compile time: inline std::array storage,
+// a constexpr Hann window and constant loop bounds throughout. The plan is the pooled one.
+template <int FftSize>
+class FixedStftStorage {
+public:
+    static_assert(FftSize >= 16 && (FftSize & (FftSize - 1)) == 0, "FFT size must be a power of two");
+
+    static constexpr int order()   noexcept { int o = 0; while ((1 << o) < FftSize) ++o; return o; }
+    static constexpr int fftSize() noexcept { return FftSize; }
+
+    const RealFft& getFft() const noexcept { return fft; }
+    const float* getWindow() const noexcept { return window.data(); }
+    float* getHistory() noexcept { return history.data(); }
+    float* getFftBuffer() noexcept { return tempFFT.data(); }
+    float* getRe() noexcept { return spectrumRe.data(); }
+    float* getIm() noexcept { return spectrumIm.data(); }
+
+private:
+    static constexpr int bins = FftSize / 2 + 1;
+    static constexpr std::array<float, FftSize> window = StftWindows::makeHann<FftSize>();
+
+    const RealFft& fft { FftPlanPool::getInstance().getPlan(order()) };
+    alignas(32) std::array<float, (size_t) FftSize * 2> history {};
+    alignas(32) std::array<float, (size_t) FftSize * 2> tempFFT {};
+    alignas(32) std::array<float, (size_t) bins> spectrumRe {};
+    alignas(32) std::array<float, (size_t) bins> spectrumIm {};
+};
+
+// Windowed STFT over a mono stream. One instance per resolution; the resulting spectrum
+// is shared by every band detector of that resolution, which slice it into bin ranges.
+// Storage decides whether the FFT size is a runtime value or a compile-time constant.
+template <typename Storage>
+class BasicStftFrontEnd {
+public:
+    template <typename... StorageArgs>
+    explicit BasicStftFrontEnd(int hopSize, StorageArgs&&... storageArgs)
+        : storage(std::forward<StorageArgs>(storageArgs)...), hopSize(hopSize)
+    {
+        jassert(hopSize > 0);
+    }
+
+    // Feed audio; onFrame(const SpectrumFrame&) is invoked once per completed hop.
+    // Samples are copied in runs up to the next hop boundary, so a block costs a few memcpys
+    // plus one contiguous window multiply and FFT per hop.
+    template <typename FrameCallback>
+    void pushAudio(const float* mono, int numSamples, FrameCallback&& onFrame)
+    {
+        while (numSamples > 0)
+        {
+            const int run = juce::jmin(numSamples, hopSize - samplesSinceHop);
+            writeHistory(mono, run);
+            mono += run;
+            numSamples -= run;
+            samplesSinceHop += run;
+            if (samplesSinceHop >= hopSize)
+            {
+                samplesSinceHop = 0;
+                computeSpectrum();
+                onFrame(SpectrumFrame { storage.getFftBuffer(), storage.getRe(), storage.getIm(), getFftSize(), hopSize, framesProcessed });
+                ++framesProcessed;
+            }
+        }
+    }
+
+    int getFftSize() const { return storage.fftSize(); }
+    int getHopSize() const { return hopSize; }
+
+private:
+    // Mirrored history: every sample is stored at [pos] and [pos + fftSize], so the latest
+    // fftSize samples are always contiguous starting at historyWrite
+    void writeHistory(const float* src, int n)
+    {
+        const int fftSize = storage.fftSize();
+        float* history = storage.getHistory();
+        while (n > 0)
+        {
+            const int chunk = juce::jmin(n, fftSize - historyWrite);
+            memcpy(history + historyWrite, src, sizeof(float) * (size_t) chunk);
+            memcpy(history + historyWrite + fftSize, src, sizeof(float) * (size_t) chunk);
+            historyWrite = (historyWrite + chunk) & (fftSize - 1);
+            src += chunk;
+            n -= chunk;
+        }
+    }
+
+    void computeSpectrum()
+    {
+        const int fftSize = storage.fftSize();
+        float* buf = storage.getFftBuffer();
+        juce::FloatVectorOperations::multiply(buf, storage.getHistory() + historyWrite, storage.getWindow(), fftSize);
+        juce::FloatVectorOperations::clear(buf + fftSize, fftSize);
+        storage.getFft().forward(buf);
+
+        const int bins = fftSize / 2 + 1;
+        float* re = storage.getRe();
+        float* im = storage.getIm();
+        for (int k = 0; k < bins; ++k)
+        {
+            re[k] = buf[k * 2];
+            im[k] = buf[k * 2 + 1];
+        }
+    }
+
+    Storage storage;
+    int hopSize { 256 };
+    int historyWrite { 0 };
+    int samplesSinceHop { 0 };
+    uint64_t framesProcessed { 0 };
+};
+
+// Copies of the frames produced during one pushAudio call, so that several band detectors can
+// consume them afterwards (possibly on other threads) while the front-end moves on.
+// Only re/im are kept; frames returned by operator[] have interleaved == nullptr.
+class SpectrumFrameBuffer {
+public:
+    // Room for maxFrames frames of fftSize (pushAudio of n samples yields at most n / hop + 1)
+    void prepare(int fftSize, int maxFrames)
+    {
+        bins = fftSize / 2 + 1;
+        stride = (bins + 7) & ~7; // keep every frame 32-byte aligned
+        capacity = maxFrames;
+        re.assign((size_t) (stride * maxFrames), 0.0f);
+        im.assign((size_t) (stride * maxFrames), 0.0f);
+        frames.assign((size_t) maxFrames, SpectrumFrame {});
+        numFrames = 0;
+    }
+
+    void clear() noexcept { numFrames = 0; }
+
+    void push(const SpectrumFrame& frame) noexcept
+    {
+        jassert(frame.fftSize / 2 + 1 == bins);
+        jassert(numFrames < capacity);
+        if (numFrames >= capacity) return;
+        float* dstRe = re.data() + (size_t) (numFrames * stride);
+        float* dstIm = im.data() + (size_t) (numFrames * stride);
+        memcpy(dstRe, frame.re, sizeof(float) * (size_t) bins);
+        memcpy(dstIm, frame.im, sizeof(float) * (size_t) bins);
+        frames[(size_t) numFrames++] = SpectrumFrame { nullptr, dstRe, dstIm, frame.fftSize, frame.hopSize, frame.frameIndex };
+    }
+
+    int size() const noexcept { return numFrames; }
+    const SpectrumFrame& operator[](int i) const noexcept { return frames[(size_t) i]; }
+
+private:
+    int bins { 0 };
+    int stride { 0 };
+    int capacity { 0 };
+    int numFrames { 0 };
+    AlignedFloatVector re, im;
+    std::vector<SpectrumFrame> frames;
+};
+
+// Any power-of-two FFT size
+class StftFrontEnd : public BasicStftFrontEnd<DynamicStftStorage> {
+public:
+    StftFrontEnd(int fftSize, int hopSize)
+        : BasicStftFrontEnd<DynamicStftStorage>(hopSize, fftSize) {}
+};
+
+// FFT size fixed at compile time (the pipeline's 1024/2048 resolutions). The hop stays a
+// runtime value because it is derived from the stream sample rate.
+template <int FftSize>
+class FixedStftFrontEnd : public BasicStftFrontEnd<FixedStftStorage<FftSize>> {
+public:
+    explicit FixedStftFrontEnd(int hopSize)
+        : BasicStftFrontEnd<FixedStftStorage<FftSize>>(hopSize) {}
+};
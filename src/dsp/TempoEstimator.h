@@ -1,109 +1,208 @@
 #pragma once
 
 #include <JuceHeader.h>
-#include <deque>
+#include "IoiHistogram.h"
+#include "CombFilterBank.h"
+#include "FftPlanPool.h"
+#include "AllocationCounter.h"
+#include <array>
 #include <numeric>
-#include <complex>
 
+// All working storage is sized in the constructor for the longest flux memory and largest
+// onset window, so addFlux/update/ingestOnsets do not touch the heap.
 class TempoEstimator {
 public:
+    static constexpr size_t defaultRecentOnsets = 64; // onsets remembered for IOI support
+
+    // How the autocorrelation over the flux window is obtained
+    enum class AcfMode
+    {
+        Streaming, // running lag products for the 40-240 BPM lags, O(lags) per new frame
+        Fft        // full recompute per estimate via zero-padded FFT, O(n log n)
+    };
+
+    // Source of the per-lag tempo evidence; candidate selection is shared
+    enum class Engine
+    {
+        Autocorrelation, // ACF over the flux window (see AcfMode)
+        CombFilterBank   // resonating comb per lag, constant cost per frame
+    };
+
     explicit TempoEstimator(double sampleRate, int hopSize)
-        : sampleRate(sampleRate), hopSize(hopSize) {}
+        : sampleRate(sampleRate), hopSize(hopSize)
+    {
+        const double framesPerSecond = sampleRate / (double) hopSize;
+        minLag = (int) std::floor(framesPerSecond * 60.0 / (double) maxBpm);
+        maxLag = (int) std::ceil (framesPerSecond * 60.0 / (double) minBpm);
+        lagProducts.assign((size_t) maxLag + 2, 0.0);
+        combBank.prepare(minLag, maxLag, framesPerSecond);
+
+        fluxRing.assign((size_t) fluxCapacity * 2, 0.0f);
+        onsetRing.assign((size_t) onsetCapacity, 0.0);
+        acf.assign((size_t) maxLag + 1, 0.0f);
+        peaks.reserve((size_t) maxLag);
+        lastCandidates.reserve((size_t) maxTopK);
+        for (int order = minFftOrder; order <= maxFftOrder; ++order)
+            fftPlans[(size_t) (order - minFftOrder)] = &FftPlanPool::getInstance().getPlan(order);
+        fftBuffer.assign((size_t) 2 << maxFftOrder, 0.0f);
+    }
 
     // Append new flux frames; compute BPM using autocorrelation over a window
     void appendFlux(const std::vector<float>& newFlux)
     {
-        flux.insert(flux.end(), newFlux.begin(), newFlux.end());
-        // Adapt memory to current tempo if available: cover ~8–12 beats
-        size_t maxFrames = memoryFrames; // base memory
-        if (bpm > 0.0)
+        addFlux(newFlux.data(), newFlux.size());
+        update();
+    }
+
+    // Append flux frames without re-estimating; pair with update() to control estimate cadence
+    void addFlux(const float* newFlux, size_t numFrames)
+    {
+        AllocationCounter::ScopedTally tally { allocationsSinceWarmUp, warmedUp };
+        const size_t maxFrames = currentMemoryFrames();
+        for (size_t i = 0; i < numFrames; ++i)
+        {
+            while (fluxCount >= maxFrames)
+                dropOldestFlux();
+            if (engine == Engine::CombFilterBank)
+                combBank.process(newFlux[i]);
+            else if (maintainsLagProducts())
+                addLagProducts(newFlux[i]);
+            pushFluxFrame(newFlux[i]);
+        }
+        framesSinceRefresh += numFrames;
+        if (maintainsLagProducts() && framesSinceRefresh >= refreshIntervalFrames)
+            refreshLagProducts();
+    }
+
+    // Re-estimate BPM and confidence from the current flux window and onsets.
+    // The first call is the warm-up; from then on any heap allocation asserts.
+    void update()
+    {
         {
-            const double framesPerSecond = sampleRate / (double) hopSize;
-            const double periodSec = 60.0 / bpm;
-            const double targetSec = juce::jlimit(4.0, 20.0, 10.0 * periodSec); // aim ~10 beats
-            maxFrames = (size_t) juce::jlimit<double>(512.0, 8192.0, std::round(targetSec * framesPerSecond));
+            AllocationCounter::ScopedTally tally { allocationsSinceWarmUp, warmedUp };
+            estimate();
+        }
+        if (!warmedUp)
+        {
+            warmedUp = true;
+            allocationsSinceWarmUp = 0;
         }
-        if (flux.size() > maxFrames)
-            flux.erase(flux.begin(), flux.begin() + (flux.size() - maxFrames));
-        estimate();
     }
 
-    // Ingest newly detected onsets (absolute times in seconds)
+    // Ingest newly detected onsets (absolute times in seconds).
+    // Each onset adds its intervals to every onset still in the window and, once the window
+    // is full, the oldest onset takes its intervals with it: O(N log bins) per onset.
     void ingestOnsets(const std::vector<double>& onsetTimesSec)
     {
+        AllocationCounter::ScopedTally tally { allocationsSinceWarmUp, warmedUp };
         for (double t : onsetTimesSec)
         {
-            recentOnsets.push_back(t);
-            if (recentOnsets.size() > maxRecentOnsets)
-                recentOnsets.pop_front();
+            while (onsetCount >= maxRecentOnsets)
+                dropOldestOnset();
+            for (size_t i = 0; i < onsetCount; ++i)
+                ioiHistogram.add(t - onsetAt(i));
+            onsetRing[(onsetStart + onsetCount) & (onsetCapacity - 1)] = t;
+            ++onsetCount;
         }
     }
 
     double getBpm() const { return bpm; }
     double getConfidence() const { return confidence; }
     const std::vector<std::pair<double, double>>& getLastCandidates() const { return lastCandidates; } // (bpm, score)
+    // Compute support of a BPM by checking inter-onset intervals near multiples of the beat period.
+    // Fraction of the IQR-trimmed pairwise IOIs within tol of k * period for some k in 1..6.
+    // The tolerance is below half a period, so the six windows never overlap and each one is a
+    // histogram range count.
+    double ioiSupportForBpm(double bpmCand) const
+    {
+        if (onsetCount < 3 || bpmCand <= 0.0) return 0.0;
+        if (ioiHistogram.size() == 0) return 0.0;
+        const double period = 60.0 / bpmCand;
+        const double tol = juce::jlimit(0.012, 0.080, 0.12 * period); // relaxed tolerance: up to 12% of period
+
+        // Trim IOI outliers using IQR fence, unless that leaves too few intervals
+        const auto& fences = ioiHistogram.getFences();
+        const bool trim = fences.inside >= 3;
+        const double lo = trim ? fences.lo : 0.0;
+        const double hi = trim ? fences.hi : IoiHistogram::maxIoiSec;
+        const int count = trim ? fences.inside : ioiHistogram.size();
+
+        int hits = 0;
+        for (int k = 1; k <= 6; ++k)
+        {
+            const double target = (double) k * period;
+            hits += ioiHistogram.countInRange(juce::jmax(lo, target - tol), juce::jmin(hi, target + tol));
+        }
+        return (double) hits / (double) count;
+    }
+
+    // Heap allocations inside addFlux/update/ingestOnsets since the first update();
+    // only counted when built with MASTER_TEMPO_COUNT_ALLOCATIONS
+    uint64_t getAllocationsSinceWarmUp() const { return allocationsSinceWarmUp; }
     // Runtime tuning
-    void setTopKCandidates(int k)               { topKCandidates = juce::jlimit(1, 10, k); }
+    void setTopKCandidates(int k)               { topKCandidates = juce::jlimit(1, maxTopK, k); }
     void setIoiWeight(double w)                 { ioiWeight = juce::jlimit(0.0, 4.0, w); }
-    void setMaxRecentOnsets(size_t n)           { maxRecentOnsets = juce::jlimit<size_t>(8, 256, n); }
-    void setMemoryFrames(size_t frames)         { memoryFrames = juce::jlimit<size_t>(512, 8192, frames); }
+    void setMaxRecentOnsets(size_t n)
+    {
+        maxRecentOnsets = juce::jlimit<size_t>(8, onsetCapacity, n);
+        while (onsetCount > maxRecentOnsets)
+            dropOldestOnset();
+    }
+    // Clamped to [minMemoryFrames(), fluxCapacity]: an estimate needs two periods of the
+    // slowest tempo in the window, so a shorter one would never produce a bpm
+    void setMemoryFrames(size_t frames)         { memoryFrames = juce::jlimit<size_t>(minMemoryFrames(), fluxCapacity, frames); }
+    size_t minMemoryFrames() const noexcept     { return juce::jmax<size_t>(512, 2 * (size_t) maxLag); }
+    // Off: the flux window stays at memoryFrames instead of following the tempo (~10 beats)
+    void setAdaptiveMemory(bool shouldAdapt)    { adaptiveMemory = shouldAdapt; }
     void setSlewPercent(double pct)             { slewPercent = juce::jlimit(0.01, 0.20, pct); }
+    void setAcfMode(AcfMode mode)
+    {
+        acfMode = mode;
+        if (maintainsLagProducts())
+            refreshLagProducts();
+    }
+    // Switching engines restarts the incoming engine's state; the flux window is kept
+    void setEngine(Engine newEngine)
+    {
+        if (newEngine == engine) return;
+        engine = newEngine;
+        if (engine == Engine::CombFilterBank)
+            combBank.reset();
+        else if (maintainsLagProducts())
+            refreshLagProducts();
+    }
+    void setCombHalfLives(double combSec, double energySec) { combBank.setHalfLives(combSec, energySec); }
+    // FFT used by AcfMode::Fft; the pool's default backend unless overridden (may allocate)
+    void setFftBackend(FftBackend backend)
+    {
+        for (int order = minFftOrder; order <= maxFftOrder; ++order)
+            fftPlans[(size_t) (order - minFftOrder)] = &FftPlanPool::getInstance().getPlan(order, backend);
+    }
 
 private:
     void estimate()
     {
-        if (flux.size() < 256) return;
+        if (fluxCount < 256) return;
 
-        // Normalize
-        std::vector<float> x(flux.begin(), flux.end());
-        const float mean = std::accumulate(x.begin(), x.end(), 0.0f) / (float) x.size();
-        for (auto& v : x) v -= mean;
-
-        const int minBpm = 40, maxBpm = 240;
         const double framesPerSecond = sampleRate / (double) hopSize;
-        const int minLag = (int) std::floor(framesPerSecond * 60.0 / (double) maxBpm);
-        const int maxLag = (int) std::ceil (framesPerSecond * 60.0 / (double) minBpm);
-        if (maxLag >= (int) x.size()) return;
+        // The longest lags need two periods of flux, or their few products decide the first
+        // estimate, and continuity then holds on to it
+        if (2 * maxLag > (int) fluxCount) return;
 
-        float energy0 = std::inner_product(x.begin(), x.end(), x.begin(), 0.0f);
+        std::fill(acf.begin(), acf.end(), 0.0f);
+        float energy0 = 0.0f;
+        if (engine == Engine::CombFilterBank)
+            energy0 = combBank.getLagScores(acf.data());
+        else if (acfMode == AcfMode::Streaming)
+            energy0 = streamingAcf();
+        else
+            energy0 = fftAcf();
         if (energy0 <= 1e-9f) return;
 
-        // FFT-based autocorrelation via convolution theorem using JUCE FFT (preallocated)
-        const size_t n = x.size();
-        size_t needed = 1; while (needed < 2 * n) needed <<= 1;
-        ensureFftSize((int) needed);
-        // zero pad and copy to real buffer (JUCE real-only FFT uses a 2 * fftSize buffer)
-        std::fill(fftBuffer.begin(), fftBuffer.end(), 0.0f);
-        std::copy(x.begin(), x.end(), fftBuffer.begin());
-        // forward real FFT (interleaved re,im pairs in fftBuffer)
-        fft->performRealOnlyForwardTransform(fftBuffer.data());
-        // compute power spectrum in-place
-        const int bins = (int) (fftSize / 2);
-        for (int k = 0; k <= bins; ++k)
-        {
-            const float re = fftBuffer[(size_t) k * 2];
-            const float im = fftBuffer[(size_t) k * 2 + 1];
-            const float p = re * re + im * im;
-            fftBuffer[(size_t) k * 2] = p;
-            fftBuffer[(size_t) k * 2 + 1] = 0.0f;
-        }
-        // inverse
-        fft->performRealOnlyInverseTransform(fftBuffer.data());
-        std::vector<float> acf(n, 0.0f);
-        for (size_t i = 0; i < n; ++i) acf[i] = fftBuffer[i];
-        // Bias-corrected autocorrelation to reduce short-lag bias: divide by (n - lag)
-        for (size_t lag = 1; lag < n; ++lag)
-        {
-            const float denom = (float) juce::jmax<size_t>(1, n - lag);
-            acf[lag] /= denom;
-        }
-
         // Energy-normalized ACF (optional) and positive lags only
         // Collect local maxima across lag range and evaluate top-K with IOI support
-        struct Peak { float score; int lag; double bpm; };
-        std::vector<Peak> peaks;
-        peaks.reserve(64);
-        auto scoreAtLag = [&acf](int lag)->float { return (lag >= 0 && (size_t)lag < acf.size()) ? acf[(size_t) lag] : 0.0f; };
+        peaks.clear();
+        auto scoreAtLag = [this](int lag)->float { return (lag >= 0 && (size_t)lag < acf.size()) ? acf[(size_t) lag] : 0.0f; };
         float prev = 0.0f, curr = 0.0f;
         curr = scoreAtLag(minLag);
         float next = scoreAtLag(minLag + 1);
@@ -134,7 +233,8 @@ private:
         double bestBpm = -1.0;
         // Merge harmonically related candidates (0.5x, 1x, 2x, 3x) and pick the best group
         struct Group { double reprBpm; double totalScore; int reprLag; float reprScore; };
-        std::vector<Group> groups;
+        std::array<Group, maxTopK> groups {};
+        size_t numGroups = 0;
         auto isHarmonic = [](double a, double b){
             // Compare on log-frequency axis; accept ratios near {1/2, 2/3, 3/4, 1, 4/3, 3/2, 2, 3}
             const double hi = juce::jmax(a, b);
@@ -151,7 +251,7 @@ private:
         };
 
         // Pre-score each peak
-        std::vector<double> peakTotals(K, 0.0);
+        std::array<double, maxTopK> peakTotals {};
         for (size_t i = 0; i < K; ++i)
         {
             const auto& pk = peaks[i];
@@ -164,7 +264,7 @@ private:
             }
             peakTotals[i] = (double) pk.score * (1.0 + ioiWeight * support) * continuity;
         }
-        std::vector<bool> used(K, false);
+        std::array<bool, maxTopK> used {};
         for (size_t i = 0; i < K; ++i)
         {
             if (used[i]) continue;
@@ -179,13 +279,14 @@ private:
                     used[j] = true;
                 }
             }
-            groups.push_back(g);
+            groups[numGroups++] = g;
         }
 
         lastCandidates.clear();
         bestTotal = -1.0; bestLag = -1; bestScore = 0.0f; bestBpm = -1.0;
-        for (const auto& g : groups)
+        for (size_t gi = 0; gi < numGroups; ++gi)
         {
+            const auto& g = groups[gi];
             lastCandidates.emplace_back(g.reprBpm, g.totalScore);
             if (g.totalScore > bestTotal)
             {
@@ -216,6 +317,164 @@ private:
         }
     }
 
+    // Mean-centred, bias-corrected ACF (acf[lag] /= n - lag) via zero-padded FFT; returns lag-0 energy
+    float fftAcf()
+    {
+        // Normalize straight into the zero-padded FFT buffer
+        const size_t n = fluxCount;
+        const float* x = fluxData();
+        const float mean = std::accumulate(x, x + n, 0.0f) / (float) n;
+
+        size_t needed = 1; while (needed < 2 * n) needed <<= 1;
+        std::fill(fftBuffer.begin(), fftBuffer.begin() + (long) (2 * needed), 0.0f);
+        float energy0 = 0.0f;
+        for (size_t i = 0; i < n; ++i)
+        {
+            const float c = x[i] - mean;
+            fftBuffer[i] = c;
+            energy0 += c * c;
+        }
+        if (energy0 <= 1e-9f) return energy0;
+
+        // FFT-based autocorrelation via convolution theorem, using the cached plan for this size
+        const auto& fft = getFftPlan(needed);
+        // forward real FFT (interleaved re,im pairs in fftBuffer)
+        fft.forward(fftBuffer.data());
+        // compute power spectrum in-place
+        const int bins = (int) (needed / 2);
+        for (int k = 0; k <= bins; ++k)
+        {
+            const float re = fftBuffer[(size_t) k * 2];
+            const float im = fftBuffer[(size_t) k * 2 + 1];
+            const float p = re * re + im * im;
+            fftBuffer[(size_t) k * 2] = p;
+            fftBuffer[(size_t) k * 2 + 1] = 0.0f;
+        }
+        // inverse
+        fft.inverse(fftBuffer.data());
+        // Bias-corrected autocorrelation to reduce short-lag bias: divide by (n - lag)
+        acf[0] = fftBuffer[0];
+        for (size_t lag = 1; lag < acf.size(); ++lag)
+        {
+            const float denom = (float) juce::jmax<size_t>(1, n - lag);
+            acf[lag] = fftBuffer[lag] / denom;
+        }
+        return energy0;
+    }
+
+    // Same quantity as fftAcf for lags minLag..maxLag, from the running lag products.
+    // With S_l = sum x_t x_{t-l} over the window, mean m and n frames:
+    //   sum (x_t - m)(x_{t-l} - m) = S_l - m (P_l + Q_l) + (n - l) m^2
+    // where P_l / Q_l are the window sums without the first / last l frames. The window sum
+    // itself is kept with the lag products, so only the head/tail sums walk the window.
+    float streamingAcf()
+    {
+        const size_t n = fluxCount;
+        const float* x = fluxData();
+        const double total = fluxSum;
+        const double m = total / (double) n;
+
+        const double energy0 = lagProducts[0] - (double) n * m * m;
+        double head = 0.0, tail = 0.0; // sums of the first / last lag frames
+        for (int lag = 1; lag <= maxLag; ++lag)
+        {
+            head += (double) x[(size_t) lag - 1];
+            tail += (double) x[n - (size_t) lag];
+            if (lag < minLag) continue;
+            const double centred = lagProducts[(size_t) lag] - m * ((total - head) + (total - tail))
+                                   + (double) (n - (size_t) lag) * m * m;
+            acf[(size_t) lag] = (float) (centred / (double) (n - (size_t) lag));
+        }
+        return (float) energy0;
+    }
+
+    // New frame v is about to be appended: add its products with the previous maxLag frames
+    void addLagProducts(float v)
+    {
+        const float* x = fluxData();
+        const size_t idx = fluxCount;
+        const size_t lags = juce::jmin((size_t) maxLag, idx);
+        fluxSum += (double) v;
+        lagProducts[0] += (double) v * (double) v;
+        for (size_t lag = 1; lag <= lags; ++lag)
+            lagProducts[lag] += (double) v * (double) x[idx - lag];
+    }
+
+    // Oldest frame is about to leave: drop its products with later frames
+    void removeOldestLagProducts()
+    {
+        const float* x = fluxData();
+        const double old = (double) x[0];
+        const size_t lags = juce::jmin((size_t) maxLag, fluxCount - 1);
+        fluxSum -= old;
+        lagProducts[0] -= old * old;
+        for (size_t lag = 1; lag <= lags; ++lag)
+            lagProducts[lag] -= old * (double) x[lag];
+    }
+
+    bool maintainsLagProducts() const { return engine == Engine::Autocorrelation && acfMode == AcfMode::Streaming; }
+
+    // Exact recompute, bounding accumulated rounding drift of the running sums
+    void refreshLagProducts()
+    {
+        std::fill(lagProducts.begin(), lagProducts.end(), 0.0);
+        const float* x = fluxData();
+        const size_t n = fluxCount;
+        fluxSum = 0.0;
+        for (size_t t = 0; t < n; ++t)
+            fluxSum += (double) x[t];
+        for (size_t lag = 0; lag <= (size_t) maxLag && lag < n; ++lag)
+        {
+            double sum = 0.0;
+            for (size_t t = lag; t < n; ++t)
+                sum += (double) x[t] * (double) x[t - lag];
+            lagProducts[lag] = sum;
+        }
+        framesSinceRefresh = 0;
+    }
+
+    // Flux window length: memoryFrames, or ~10 beats of the current tempo once one is known
+    // (unless adaptive memory is off)
+    size_t currentMemoryFrames() const
+    {
+        if (bpm <= 0.0 || !adaptiveMemory) return memoryFrames;
+        const double framesPerSecond = sampleRate / (double) hopSize;
+        const double periodSec = 60.0 / bpm;
+        const double targetSec = juce::jlimit(4.0, 20.0, 10.0 * periodSec); // aim ~10 beats
+        return (size_t) juce::jlimit<double>((double) minMemoryFrames(), (double) fluxCapacity, std::round(targetSec * framesPerSecond));
+    }
+
+    // Flux ring is mirrored (each frame stored at [pos] and [pos + capacity]), so the window
+    // is always contiguous from fluxData()
+    const float* fluxData() const { return fluxRing.data() + fluxStart; }
+
+    void pushFluxFrame(float v)
+    {
+        jassert(fluxCount < fluxCapacity);
+        const size_t pos = (fluxStart + fluxCount) & (fluxCapacity - 1);
+        fluxRing[pos] = v;
+        fluxRing[pos + fluxCapacity] = v;
+        ++fluxCount;
+    }
+
+    void dropOldestFlux()
+    {
+        if (maintainsLagProducts())
+            removeOldestLagProducts();
+        fluxStart = (fluxStart + 1) & (fluxCapacity - 1);
+        --fluxCount;
+    }
+
+    double onsetAt(size_t i) const { return onsetRing[(onsetStart + i) & (onsetCapacity - 1)]; }
+
+    const RealFft& getFftPlan(size_t size) const
+    {
+        int order = 0;
+        while (((size_t) 1 << order) < size) ++order;
+        jassert(order >= minFftOrder && order <= maxFftOrder);
+        return *fftPlans[(size_t) (juce::jlimit(minFftOrder, maxFftOrder, order) - minFftOrder)];
+    }
+
     static double lagToBpm(int lag, double framesPerSecond)
     {
         const double periodSec = (double) lag / framesPerSecond;
@@ -232,83 +491,62 @@ private:
         return 0.7 + 0.3 * w; // reduce influence of the prior
     }
 
-    // Compute support of a BPM by checking inter-onset intervals near multiples of the beat period
-    double ioiSupportForBpm(double bpmCand) const
+    void dropOldestOnset()
     {
-        if (recentOnsets.size() < 3 || bpmCand <= 0.0) return 0.0;
-        const double period = 60.0 / bpmCand;
-        const double tol = juce::jlimit(0.012, 0.080, 0.12 * period); // relaxed tolerance: up to 12% of period
-
-        // Build IOIs using all pairwise differences within a recent window
-        std::vector<double> iois;
-        const size_t N = recentOnsets.size();
-        for (size_t i = 0; i < N; ++i)
-        {
-            for (size_t j = i + 1; j < N; ++j)
-            {
-                const double d = recentOnsets[j] - recentOnsets[i];
-                if (d > 0.02 && d < 3.0) // ignore implausible gaps
-                    iois.push_back(d);
-            }
-        }
-        if (iois.empty()) return 0.0;
-        // Trim IOI outliers using IQR fence
-        std::sort(iois.begin(), iois.end());
-        const auto qIndex = [&](double q){ return (size_t) juce::jlimit<double>(0.0, (double) (iois.size()-1), q * (iois.size()-1)); };
-        const double q1 = iois[qIndex(0.25)];
-        const double q3 = iois[qIndex(0.75)];
-        const double iqr = juce::jmax(1.0e-6, q3 - q1);
-        const double lo = q1 - 1.5 * iqr;
-        const double hi = q3 + 1.5 * iqr;
-        std::vector<double> trimmed; trimmed.reserve(iois.size());
-        for (double d : iois) if (d >= lo && d <= hi) trimmed.push_back(d);
-        if (trimmed.size() >= 3) iois.swap(trimmed);
-
-        int hits = 0;
-        for (double d : iois)
-        {
-            const int k = juce::jlimit(1, 6, (int) std::round(d / period));
-            const double target = (double) k * period;
-            if (std::abs(d - target) <= tol)
-                ++hits;
-        }
-        return (double) hits / (double) iois.size();
+        const double oldest = onsetAt(0);
+        onsetStart = (onsetStart + 1) & (onsetCapacity - 1);
+        --onsetCount;
+        for (size_t i = 0; i < onsetCount; ++i)
+            ioiHistogram.remove(onsetAt(i) - oldest);
     }
 
     double sampleRate { 48000.0 };
     int hopSize { 256 };
-    std::vector<float> flux;
+    // Longest flux memory and largest onset window (powers of two for the ring masks)
+    static constexpr size_t fluxCapacity = 8192;
+    static constexpr size_t onsetCapacity = 1024;
+    static constexpr int maxTopK = 10;
+    std::vector<float> fluxRing;
+    size_t fluxStart { 0 };
+    size_t fluxCount { 0 };
     double bpm { -1.0 };
     double confidence { 0.0 };
-    std::deque<double> recentOnsets;
-    size_t maxRecentOnsets { 64 };
+    std::vector<double> onsetRing;
+    size_t onsetStart { 0 };
+    size_t onsetCount { 0 };
+    size_t maxRecentOnsets { defaultRecentOnsets };
+    IoiHistogram ioiHistogram; // all pairwise intervals between the onsets in onsetRing
     int topKCandidates { 5 };
     double ioiWeight { 1.0 };
     std::vector<std::pair<double, double>> lastCandidates;
     size_t memoryFrames { 2048 };
+    bool adaptiveMemory { true };
     double slewPercent { 0.03 }; // 3% per update
+    // Lag range covering minBpm..maxBpm at the flux frame rate
+    static constexpr int minBpm = 40, maxBpm = 240;
+    int minLag { 0 };
+    int maxLag { 0 };
+    // Streaming ACF state: lagProducts[l] = sum over the window of x_t * x_{t-l}, fluxSum = sum of x_t
+    AcfMode acfMode { AcfMode::Streaming };
+    std::vector<double> lagProducts;
+    double fluxSum { 0.0 };
+    size_t framesSinceRefresh { 0 };
+    Engine engine { Engine::Autocorrelation };
+    CombFilterBank combBank;
+    static constexpr size_t refreshIntervalFrames = 32768; // frames between exact recomputes (~2.7 min at 5 ms)
     // Hysteresis
     int stableCandCount { 0 };
 
-    // JUCE FFT buffers (preallocated)
-    std::unique_ptr<juce::dsp::FFT> fft;
-    int fftOrder { 0 };
-    int fftSize { 0 };
-    std::vector<float> fftBuffer; // size = 2 * fftSize for JUCE real-only FFT
-
-    void ensureFftSize(int minSize)
-    {
-        int order = 0; int size = 1;
-        while (size < minSize) { size <<= 1; ++order; }
-        if (size != fftSize)
-        {
-            fftSize = size;
-            fftOrder = order;
-            fft = std::make_unique<juce::dsp::FFT>(fftOrder);
-            fftBuffer.resize((size_t) (2 * fftSize));
-        }
-    }
-};
-
+    // Estimate workspaces
+    struct Peak { float score; int lag; double bpm; };
+    std::vector<float> acf;
+    std::vector<Peak> peaks;
 
+    // Pooled FFT plans for every zero-padded ACF size: 2 * 256 frames up to 2 * fluxCapacity
+    static constexpr int minFftOrder = 9, maxFftOrder = 14;
+    std::array<const RealFft*, (size_t) (maxFftOrder - minFftOrder + 1)> fftPlans {};
+    AlignedFloatVector fftBuffer; // 2 * largest size, real-only FFT layout
 
+    bool warmedUp { false };
+    uint64_t allocationsSinceWarmUp { 0 };
+};
@@ -0,0 +1,161 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "TempoEstimator.h"
+#include "SpscQueue.h"
+#include "Snapshot.h"
+#include "StageProfiler.h"
+#include <array>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+// Result of one tempo estimate, published by TempoWorker
+struct TempoSnapshot
+{
+    static constexpr int maxCandidates = 10;
+
+    uint64_t version { 0 };      // increments on every estimate
+    double bpm { -1.0 };
+    double confidence { 0.0 };
+    int numCandidates { 0 };
+    struct Candidate { double bpm; double score; };
+    std::array<Candidate, maxCandidates> candidates {};
+    uint64_t framesAnalysed { 0 }; // total flux frames consumed when this estimate ran
+};
+
+// Runs TempoEstimator on its own thread. The producer (one thread) queues fused flux and
+// gated onsets without blocking; estimates run at a configurable cadence and are published
+// as a versioned snapshot that any thread can poll.
+class TempoWorker {
+public:
+    TempoWorker(double sampleRate, int hopSize)
+        : estimator(sampleRate, hopSize)
+    {
+        fluxScratch.resize(fluxQueue.getCapacity());
+        onsetScratch.reserve(onsetQueue.getCapacity());
+    }
+
+    ~TempoWorker() { stop(); }
+
+    // Estimate once at least everyNFrames new flux frames arrived (0 = no frame trigger),
+    // or every intervalMs if any new frames arrived (0 = no time trigger).
+    void setCadence(int everyNFrames, double intervalMs)
+    {
+        cadenceFrames.store(juce::jmax(0, everyNFrames), std::memory_order_relaxed);
+        cadenceMs.store(juce::jmax(0.0, intervalMs), std::memory_order_relaxed);
+    }
+
+    // Configure before start() (or between stop()/start()); not synchronised with the worker
+    TempoEstimator& getEstimator() { return estimator; }
+    void setProfiler(StageProfiler* p) { profiler = p; } // times each estimate (TempoEstimate)
+
+    void start()
+    {
+        if (running.exchange(true)) return;
+        lastEstimateMs = juce::Time::getMillisecondCounterHiRes();
+        worker = std::thread([this]
+        {
+            while (running.load(std::memory_order_acquire))
+            {
+                const double interval = cadenceMs.load(std::memory_order_relaxed);
+                wake.wait(interval > 0.0 ? juce::jlimit(1.0, 10.0, interval) : 10.0);
+                processPending();
+            }
+        });
+    }
+
+    void stop()
+    {
+        if (!running.exchange(false)) return;
+        wake.signal();
+        if (worker.joinable()) worker.join();
+    }
+
+    // Producer side (single thread)
+    void pushFlux(const float* frames, size_t numFrames)
+    {
+        for (size_t i = 0; i < numFrames; ++i)
+            fluxQueue.push(frames[i]);
+        if (numFrames > 0) wake.signal();
+    }
+
+    void pushOnsets(const double* onsetTimesSec, size_t numOnsets)
+    {
+        for (size_t i = 0; i < numOnsets; ++i)
+            onsetQueue.push(onsetTimesSec[i]);
+    }
+
+    // Reader side (any thread)
+    TempoSnapshot getSnapshot() const { return snapshot.read(); }
+    uint64_t getVersion() const { return snapshot.getVersion(); }
+    uint64_t getDroppedFluxFrames() const { return fluxQueue.getOverflowCount(); }
+
+    // Drain queued input and estimate if the cadence is due. Called by the worker thread;
+    // can also be called directly (without start()) to run the worker inline.
+    void processPending()
+    {
+        onsetScratch.resize(onsetQueue.getCapacity());
+        onsetScratch.resize(onsetQueue.drain(onsetScratch.data(), onsetScratch.size()));
+        if (!onsetScratch.empty())
+            estimator.ingestOnsets(onsetScratch);
+
+        const size_t n = fluxQueue.drain(fluxScratch.data(), fluxScratch.size());
+        if (n > 0)
+        {
+            estimator.addFlux(fluxScratch.data(), n);
+            pendingFrames += n;
+            totalFrames += n;
+        }
+        if (pendingFrames == 0) return;
+
+        const int everyN = cadenceFrames.load(std::memory_order_relaxed);
+        const double everyMs = cadenceMs.load(std::memory_order_relaxed);
+        const double nowMs = juce::Time::getMillisecondCounterHiRes();
+        const bool frameDue = everyN > 0 && pendingFrames >= (size_t) everyN;
+        const bool timeDue = everyMs > 0.0 && (nowMs - lastEstimateMs) >= everyMs;
+        if (!frameDue && !timeDue && (everyN > 0 || everyMs > 0.0)) return;
+
+        {
+            StageProfiler::ScopedTimer timer(profiler, StageProfiler::TempoEstimate);
+            estimator.update();
+        }
+        pendingFrames = 0;
+        lastEstimateMs = nowMs;
+        publish();
+    }
+
+private:
+    void publish()
+    {
+        TempoSnapshot s;
+        s.version = ++estimates;
+        s.bpm = estimator.getBpm();
+        s.confidence = estimator.getConfidence();
+        const auto& cands = estimator.getLastCandidates();
+        s.numCandidates = (int) juce::jmin(cands.size(), (size_t) TempoSnapshot::maxCandidates);
+        for (int i = 0; i < s.numCandidates; ++i)
+            s.candidates[(size_t) i] = { cands[(size_t) i].first, cands[(size_t) i].second };
+        s.framesAnalysed = totalFrames;
+        snapshot.publish(s);
+    }
+
+    TempoEstimator estimator;
+    SpscQueue<float> fluxQueue { 16384 };
+    SpscQueue<double> onsetQueue { 1024 };
+    std::vector<float> fluxScratch;
+    std::vector<double> onsetScratch;
+    SeqlockSnapshot<TempoSnapshot> snapshot;
+    StageProfiler* profiler { nullptr };
+
+    std::atomic<int> cadenceFrames { 0 };
+    std::atomic<double> cadenceMs { 33.0 }; // ~30 estimates/s, the previous timer rate
+    size_t pendingFrames { 0 };
+    uint64_t totalFrames { 0 };
+    uint64_t estimates { 0 };
+    double lastEstimateMs { 0.0 };
+
+    std::thread worker;
+    std::atomic<bool> running { false };
+    juce::WaitableEvent wake;
+};
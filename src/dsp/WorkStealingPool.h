@@ -0,0 +1,300 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "AllocationCounter.h"
+#include <array>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+// Per-task and per-batch timing for repeated parallelFor calls with the same task layout
+// (task i is the same job every batch). Written by whichever thread ran the task, readable
+// from any thread. speed-up = summed task time / batch wall time.
+class TaskTimings {
+public:
+    static constexpr int maxTasks = 32;
+
+    struct Task
+    {
+        float lastUs { 0.0f };
+        float averageUs { 0.0f };
+        int lastThread { 0 }; // 0 = the calling thread, 1..N = pool worker
+    };
+
+    Task getTask(int index) const
+    {
+        jassert(index >= 0 && index < maxTasks);
+        const auto& t = tasks[(size_t) index];
+        return { t.lastUs.load(std::memory_order_relaxed), t.averageUs.load(std::memory_order_relaxed),
+                 t.lastThread.load(std::memory_order_relaxed) };
+    }
+
+    float getLastWallUs() const     { return lastWallUs.load(std::memory_order_relaxed); }
+    float getAverageWallUs() const  { return averageWallUs.load(std::memory_order_relaxed); }
+    float getAverageSpeedup() const
+    {
+        const float wall = averageWallUs.load(std::memory_order_relaxed);
+        return wall > 0.0f ? averageTaskSumUs.load(std::memory_order_relaxed) / wall : 1.0f;
+    }
+    uint64_t getNumBatches() const  { return batches.load(std::memory_order_relaxed); }
+
+    void recordTask(int index, double micros, int thread) noexcept
+    {
+        if (index < 0 || index >= maxTasks) return;
+        auto& t = tasks[(size_t) index];
+        t.lastUs.store((float) micros, std::memory_order_relaxed);
+        t.averageUs.store(smooth(t.averageUs.load(std::memory_order_relaxed), (float) micros), std::memory_order_relaxed);
+        t.lastThread.store(thread, std::memory_order_relaxed);
+        taskSumUs.fetch_add((uint64_t) (micros * 1000.0), std::memory_order_relaxed);
+    }
+
+    // Called by the submitting thread after the batch joined
+    void recordBatch(double wallMicros) noexcept
+    {
+        const float sumUs = (float) taskSumUs.exchange(0, std::memory_order_relaxed) * 0.001f;
+        lastWallUs.store((float) wallMicros, std::memory_order_relaxed);
+        averageWallUs.store(smooth(averageWallUs.load(std::memory_order_relaxed), (float) wallMicros), std::memory_order_relaxed);
+        averageTaskSumUs.store(smooth(averageTaskSumUs.load(std::memory_order_relaxed), sumUs), std::memory_order_relaxed);
+        batches.fetch_add(1, std::memory_order_relaxed);
+    }
+
+private:
+    static float smooth(float average, float value) noexcept
+    {
+        return average == 0.0f ? value : average + 0.05f * (value - average);
+    }
+
+    struct AtomicTask
+    {
+        std::atomic<float> lastUs { 0.0f };
+        std::atomic<float> averageUs { 0.0f };
+        std::atomic<int> lastThread { 0 };
+    };
+
+    std::array<AtomicTask, maxTasks> tasks;
+    std::atomic<uint64_t> taskSumUs { 0 }; // nanoseconds of the running batch
+    std::atomic<float> lastWallUs { 0.0f };
+    std::atomic<float> averageWallUs { 0.0f };
+    std::atomic<float> averageTaskSumUs { 0.0f };
+    std::atomic<uint64_t> batches { 0 };
+};
+
+// Counting semaphore on the platform primitive (a POSIX or dispatch semaphore, a Win32
+// semaphore). signal() is one call into the OS with no user-space lock, so a real-time thread
+// can wake workers with it. Defined in src/work_stealing_pool.cpp.
+class PoolSemaphore {
+public:
+    PoolSemaphore();
+    ~PoolSemaphore();
+
+    void signal(int count) noexcept;
+    void wait() noexcept;
+
+private:
+    void* handle { nullptr };
+
+    JUCE_DECLARE_NON_COPYABLE(PoolSemaphore)
+};
+
+// Fork-join pool for short, independent jobs (per-band detectors, per-resolution STFTs).
+// parallelFor(n, fn) runs fn(0..n-1) and returns when all have finished. The submitter
+// publishes the batch in one of maxBatches slots; workers and the submitter claim task indices
+// from it with a compare-and-swap, so whoever is free takes the next task. The submitting
+// thread works through tasks too instead of sleeping until the join.
+// With zero workers (small machines, or by request) parallelFor runs the tasks inline, in order.
+// Several threads may call parallelFor at once; with all slots taken the batch runs inline.
+// No allocation after construction and no locks: submitting, claiming and waking workers are
+// atomics plus PoolSemaphore::signal, so parallelFor is safe from a real-time thread.
+class WorkStealingPool {
+public:
+    static constexpr int maxWorkers = 15;
+    static constexpr int maxBatches = 32; // parallelFor calls in flight at once
+
+    // Leaves a core each for audio capture and the thread that submits the work
+    static int defaultNumWorkers()
+    {
+        const int cores = (int) std::thread::hardware_concurrency();
+        return cores > 2 ? juce::jmin(maxWorkers, cores - 2) : 0;
+    }
+
+    explicit WorkStealingPool(int numWorkers = defaultNumWorkers())
+    {
+        for (int i = 1; i <= juce::jlimit(0, maxWorkers, numWorkers); ++i)
+            workers.emplace_back([this, i] { workerLoop(i); });
+    }
+
+    ~WorkStealingPool()
+    {
+        running.store(false, std::memory_order_seq_cst);
+        wakeSemaphore.signal((int) workers.size());
+        for (auto& w : workers)
+            if (w.joinable()) w.join();
+    }
+
+    int getNumWorkers() const noexcept { return (int) workers.size(); }
+
+    // fn(int taskIndex) must be safe to call concurrently for different indices
+    template <typename Fn>
+    void parallelFor(int numTasks, Fn&& fn, TaskTimings* timings = nullptr)
+    {
+        if (numTasks <= 0) return;
+        const double startMs = juce::Time::getMillisecondCounterHiRes();
+
+        Slot* slot = (workers.empty() || numTasks == 1) ? nullptr : reserveSlot();
+        if (slot == nullptr)
+        {
+            for (int i = 0; i < numTasks; ++i)
+                runTimed(fn, i, timings, 0);
+        }
+        else
+        {
+            using FnType = typename std::remove_reference<Fn>::type;
+            slot->invoke.store([](void* context, int index, TaskTimings* t, int thread)
+                               {
+                                   runTimed(*static_cast<FnType*>(context), index, t, thread);
+                               }, std::memory_order_relaxed);
+            slot->context.store((void*) &fn, std::memory_order_relaxed);
+            slot->timings.store(timings, std::memory_order_relaxed);
+            slot->numTasks.store((uint32_t) numTasks, std::memory_order_relaxed);
+            slot->remaining.store(numTasks, std::memory_order_relaxed);
+
+            // Publish under a new generation. seq_cst pairs with the sleeper count in
+            // workerLoop: either the worker sees the batch before it waits or this sees the
+            // sleeper
+            const uint64_t generation = (slot->claim.load(std::memory_order_relaxed) >> 32) + 1;
+            slot->claim.store(generation << 32, std::memory_order_seq_cst);
+            wakeWorkers(numTasks - 1);
+
+            // Help until every task of this batch has finished, own tasks first (tasks of other
+            // batches may be picked up on the way; they are independent)
+            const auto first = (size_t) (slot - slots.data());
+            while (slot->remaining.load(std::memory_order_acquire) > 0)
+                if (! runOneTask(first, 0))
+                    std::this_thread::yield();
+
+            // Retire the generation before the slot can be reused: a thread that read the old
+            // claim word then fails its compare-and-swap
+            slot->claim.store((generation << 32) | retired, std::memory_order_release);
+            slot->inUse.store(false, std::memory_order_release);
+        }
+
+        if (timings != nullptr)
+            timings->recordBatch((juce::Time::getMillisecondCounterHiRes() - startMs) * 1000.0);
+    }
+
+private:
+    static constexpr uint32_t retired = 0xffffffffu;
+
+    // One published batch. claim = generation << 32 | next task index; a thread reads the batch
+    // fields, then claims an index by swapping in index + 1 under the same generation. A
+    // successful swap proves the fields belonged to that generation: the submitter rewrites
+    // them only after every claimed task has finished.
+    struct Slot
+    {
+        std::atomic<uint64_t> claim { retired };
+        std::atomic<uint32_t> numTasks { 0 };
+        std::atomic<void (*)(void*, int, TaskTimings*, int)> invoke { nullptr };
+        std::atomic<void*> context { nullptr };
+        std::atomic<TaskTimings*> timings { nullptr };
+        std::atomic<int> remaining { 0 };
+        std::atomic<bool> inUse { false };
+    };
+
+    template <typename Fn>
+    static void runTimed(Fn& fn, int index, TaskTimings* timings, int thread)
+    {
+        if (timings == nullptr)
+        {
+            fn(index);
+            return;
+        }
+        const double startMs = juce::Time::getMillisecondCounterHiRes();
+        fn(index);
+        timings->recordTask(index, (juce::Time::getMillisecondCounterHiRes() - startMs) * 1000.0, thread);
+    }
+
+    Slot* reserveSlot() noexcept
+    {
+        const auto start = (size_t) nextSlot.fetch_add(1, std::memory_order_relaxed);
+        for (size_t k = 0; k < slots.size(); ++k)
+        {
+            auto& slot = slots[(start + k) % slots.size()];
+            bool expected = false;
+            if (! slot.inUse.load(std::memory_order_relaxed)
+                && slot.inUse.compare_exchange_strong(expected, true, std::memory_order_acquire))
+                return &slot;
+        }
+        return nullptr;
+    }
+
+    // Claims and runs one task of any published batch, scanning from slot `first`
+    bool runOneTask(size_t first, int thread)
+    {
+        for (size_t k = 0; k < slots.size(); ++k)
+        {
+            auto& slot = slots[(first + k) % slots.size()];
+            uint64_t claim = slot.claim.load(std::memory_order_acquire);
+            while ((uint32_t) claim < slot.numTasks.load(std::memory_order_relaxed))
+            {
+                const auto invoke = slot.invoke.load(std::memory_order_relaxed);
+                void* const context = slot.context.load(std::memory_order_relaxed);
+                TaskTimings* const timings = slot.timings.load(std::memory_order_relaxed);
+                if (slot.claim.compare_exchange_weak(claim, claim + 1, std::memory_order_acq_rel, std::memory_order_acquire))
+                {
+                    invoke(context, (int) (uint32_t) claim, timings, thread);
+                    // Last access to the batch: the submitter may return as soon as this reaches zero
+                    slot.remaining.fetch_sub(1, std::memory_order_acq_rel);
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+
+    // Hands up to `count` semaphore posts to workers that announced themselves as sleepers
+    void wakeWorkers(int count) noexcept
+    {
+        int s = sleepers.load(std::memory_order_seq_cst);
+        while (s > 0)
+        {
+            const int n = juce::jmin(s, count);
+            if (sleepers.compare_exchange_weak(s, s - n, std::memory_order_seq_cst))
+            {
+                wakeSemaphore.signal(n);
+                return;
+            }
+        }
+    }
+
+    void workerLoop(int self)
+    {
+        const auto first = (size_t) self;
+        while (running.load(std::memory_order_acquire))
+        {
+            if (runOneTask(first, self))
+                continue;
+
+            // Announce the sleep, then look once more (see parallelFor)
+            sleepers.fetch_add(1, std::memory_order_seq_cst);
+            if (runOneTask(first, self))
+            {
+                // Withdraw the announcement, unless a submitter already counted this worker:
+                // then its post is ours to take, or the counts drift
+                int s = sleepers.load(std::memory_order_seq_cst);
+                while (s > 0 && ! sleepers.compare_exchange_weak(s, s - 1, std::memory_order_seq_cst)) {}
+                if (s == 0)
+                    wakeSemaphore.wait();
+                continue;
+            }
+            wakeSemaphore.wait();
+        }
+    }
+
+    std::array<Slot, maxBatches> slots;
+    std::atomic<uint32_t> nextSlot { 0 };
+    std::vector<std::thread> workers;
+    std::atomic<int> sleepers { 0 }; // announced and not yet handed a post
+    PoolSemaphore wakeSemaphore;
+    std::atomic<bool> running { true };
+};
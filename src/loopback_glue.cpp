@@ -16,39 +16,40 @@ bool MainComponent::startLoopbackCaptureForEndpoint (const juce::String& outputN
    #endif
 }
 
-void MainComponent::handleLoopbackSamples (const float* interleaved, int frames, int chans, double sr, double qpcSeconds)
+bool MainComponent::addLoopbackStream (const juce::String& outputName, const juce::String& oscPrefix)
 {
-    juce::HeapBlock<float> mono (frames);
-    if (chans <= 1)
-    {
-        juce::FloatVectorOperations::copy (mono.get(), interleaved, frames);
-    }
-    else
+   #if JUCE_WINDOWS
+    if ((int) streams.size() >= maxStreams)
+        return false;
+    auto stream = std::make_unique<AnalysisPipeline> (detectorPool, oscPrefix);
+    auto* pipeline = stream.get();
+    auto capture = std::make_unique<WASAPILoopbackCapture>();
+    pipeline->setHighPassHz ((float) hpfSlider.getValue());
+    pipeline->setLowPassHz ((float) lpfSlider.getValue());
+    pipeline->connectOsc ("127.0.0.1", 9000);
+    pipeline->start();
+    const bool started = capture->start (outputName, [pipeline](const float* interleaved, int frames, int chans, double sr, double qpcSeconds)
     {
-        const float invCh = 1.0f / (float) juce::jmax(1, chans);
-        for (int i = 0; i < frames; ++i)
-        {
-            double sum = 0.0;
-            for (int c = 0; c < chans; ++c)
-            {
-                const float s = interleaved[i * chans + c];
-                sum += (double) s;
-            }
-            mono[i] = (float) (sum * invCh);
-        }
-    }
+        pipeline->pushAudio (interleaved, frames, chans, sr, qpcSeconds);
+    });
+    if (! started)
+        return false;
+    streams.push_back (std::move (stream));
+    extraLoopbackCaptures.push_back (std::move (capture));
+    return true;
+   #else
+    juce::ignoreUnused (outputName, oscPrefix);
+    return false;
+   #endif
+}
 
-    if (currentSampleRate.load() != sr)
+void MainComponent::handleLoopbackSamples (const float* interleaved, int frames, int chans, double sr, double qpcSeconds)
+{
+    // A format change reconfigures the pipeline (allocates and locks) before real-time checks apply
+    if (primaryStream().getSampleRate() != sr)
+    {
+        RealtimeSafety::ScopedNonRealtime reconfigure;
         prepareProcessing (sr, 512);
-
-    int start1 = 0, size1 = 0, start2 = 0, size2 = 0;
-    fifo.prepareToWrite (frames, start1, size1, start2, size2);
-    if (size1 > 0) juce::FloatVectorOperations::copy (ringBuffer.getWritePointer(0) + start1, mono.get(), size1);
-    if (size2 > 0) juce::FloatVectorOperations::copy (ringBuffer.getWritePointer(0) + start2, mono.get() + size1, size2);
-    fifo.finishedWrite (size1 + size2);
-
-    capturedSamples.fetch_add((uint64_t) frames, std::memory_order_relaxed);
-    lastQpcSeconds.store(qpcSeconds, std::memory_order_relaxed);
+    }
+    primaryStream().pushAudio (interleaved, frames, chans, sr, qpcSeconds);
 }
-
-
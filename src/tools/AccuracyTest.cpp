@@ -0,0 +1,284 @@
+#include "AccuracyTest.h"
+#include "core/OfflineAnalysis.h"
+#include "TestSignals.h"
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <limits>
+#include <string>
+
+namespace
+{
+    struct SignalScore
+    {
+        double bpmErrorPct { 0.0 };
+        double octavePct { 0.0 };
+        double inTolerancePct { 0.0 };
+        double lockSec { -1.0 };
+        double relockSec { -1.0 };
+        double phaseMs { 0.0 };
+        double beatsPct { 0.0 };
+        double cpuMsPerSec { 0.0 };
+        bool locked { false };      // after the start and after every change
+        bool hasChange { false };
+    };
+
+    // Pass thresholds per standard signal, with headroom over the current results so only a
+    // real regression fails. A negative limit is not checked.
+    struct SignalLimits
+    {
+        const char* name;
+        double maxBpmErrorPct;
+        double maxOctavePct;
+        double maxLockSec;
+        double maxRelockSec;
+        bool acceptOctave;          // half or double the true tempo counts as right
+        // Known miss: exactly these limits (as failedLimits lists them) are expected to fail.
+        // Failing any other way, or passing, fails the test until the entry is updated.
+        const char* expectedFailure;
+    };
+
+    constexpr SignalLimits standardLimits[] {
+        { "click-120",       1.0,   5.0,  5.0, -1.0, false, nullptr },
+        { "drums-95",        1.0,   5.0,  5.0, -1.0, false, nullptr },
+        { "drums-128",       1.0,   5.0,  5.0, -1.0, false, nullptr },
+        // Settles at half tempo (87 BPM), the usual reading of a 174 BPM loop
+        { "drums-174",       1.0,  -1.0,  5.0, -1.0, true,  nullptr },
+        { "ramp-100-140",    4.0,   5.0,  5.0, -1.0, false, nullptr },
+        // After the jump to 150 the estimate falls to 60 instead of relocking
+        { "step-120-150",    1.0,   5.0,  5.0,  6.0, false, "relock octave" },
+        { "step-128-100",    1.0,   5.0,  5.0,  6.0, false, nullptr },
+        { "swing-110",       1.0,   5.0,  5.0, -1.0, false, nullptr },
+        { "noise-120-6db",  25.0,  40.0, 15.0, -1.0, false, nullptr },
+        { "noise-140-0db",  40.0,  55.0, 20.0, -1.0, false, nullptr },
+    };
+
+    // Signals outside the table only have to lock
+    SignalLimits limitsFor (const juce::String& name)
+    {
+        for (const auto& limits : standardLimits)
+            if (name == limits.name)
+                return limits;
+        return { "", -1.0, -1.0, -1.0, -1.0, false, nullptr };
+    }
+
+    // The tempo an estimate is scored against: the truth, or with acceptOctave whichever of
+    // half, the truth and double is closest
+    double referenceBpm (const TestSignal& signal, double timeSec, double estimate, bool acceptOctave)
+    {
+        const double truth = signal.bpmAt (timeSec);
+        if (! acceptOctave || estimate <= 0.0)
+            return truth;
+        double best = truth;
+        for (double ratio : { 0.5, 2.0 })
+            if (std::abs (estimate - ratio * truth) < std::abs (estimate - best))
+                best = ratio * truth;
+        return best;
+    }
+
+    double median (std::vector<double> values)
+    {
+        if (values.empty())
+            return 0.0;
+        const auto mid = values.begin() + (long) (values.size() / 2);
+        std::nth_element (values.begin(), mid, values.end());
+        return *mid;
+    }
+
+    double nearestDistance (const std::vector<double>& sorted, double t)
+    {
+        auto it = std::lower_bound (sorted.begin(), sorted.end(), t);
+        double best = std::numeric_limits<double>::infinity();
+        if (it != sorted.end())
+            best = *it - t;
+        if (it != sorted.begin())
+            best = juce::jmin (best, t - *(it - 1));
+        return best;
+    }
+
+    // Time of the first estimate in [from, to) that starts a run of at least holdSec within
+    // tolerance; -1 if there is none
+    double findLock (const std::vector<OfflineAnalysisResult::TempoPoint>& tempo, const TestSignal& signal,
+                     double from, double to, double tolerance, double holdSec, bool acceptOctave)
+    {
+        double runStart = -1.0;
+        for (const auto& p : tempo)
+        {
+            if (p.timeSec < from || p.timeSec >= to)
+                continue;
+            const double truth = referenceBpm (signal, p.timeSec, p.bpm, acceptOctave);
+            if (p.bpm > 0.0 && std::abs (p.bpm - truth) <= tolerance * truth)
+            {
+                if (runStart < 0.0)
+                    runStart = p.timeSec;
+                if (p.timeSec - runStart >= holdSec)
+                    return runStart;
+            }
+            else
+            {
+                runStart = -1.0;
+            }
+        }
+        return -1.0;
+    }
+
+    SignalScore score (const TestSignal& signal, const OfflineAnalysisResult& result, const AccuracyTestOptions& options,
+                       bool acceptOctave)
+    {
+        SignalScore s;
+        s.cpuMsPerSec = result.durationSec > 0.0 ? 1000.0 * result.processingSec / result.durationSec : 0.0;
+        s.hasChange = ! signal.tempoChanges.empty();
+
+        // Octave errors over every estimate
+        int octaves = 0, estimates = 0;
+        for (const auto& p : result.tempo)
+        {
+            if (p.bpm <= 0.0)
+                continue;
+            const double ratio = p.bpm / signal.bpmAt (p.timeSec);
+            if (std::abs (ratio - 2.0) <= 2.0 * options.lockTolerance || std::abs (ratio - 0.5) <= 0.5 * options.lockTolerance)
+                ++octaves;
+            ++estimates;
+        }
+        s.octavePct = estimates > 0 ? 100.0 * octaves / estimates : 0.0;
+
+        // Segments between tempo changes; each is scored from its lock on
+        std::vector<double> bounds { 0.0 };
+        bounds.insert (bounds.end(), signal.tempoChanges.begin(), signal.tempoChanges.end());
+        bounds.push_back (result.durationSec);
+
+        std::vector<double> bpmErrors, phaseErrors;
+        int trueBeats = 0, hitBeats = 0, inTolerance = 0;
+        s.locked = true;
+        for (size_t seg = 0; seg + 1 < bounds.size(); ++seg)
+        {
+            const double from = bounds[seg], to = bounds[seg + 1];
+            const double lock = findLock (result.tempo, signal, from, to, options.lockTolerance, options.lockHoldSec, acceptOctave);
+            if (seg == 0)
+                s.lockSec = lock;
+            else
+                s.relockSec = lock < 0.0 ? -1.0 : lock - from;
+            if (lock < 0.0)
+            {
+                s.locked = false;
+                continue;
+            }
+
+            for (const auto& p : result.tempo)
+                if (p.timeSec >= lock && p.timeSec < to)
+                {
+                    const double truth = referenceBpm (signal, p.timeSec, p.bpm, acceptOctave);
+                    bpmErrors.push_back (100.0 * std::abs (p.bpm - truth) / truth);
+                    if (p.bpm > 0.0 && std::abs (p.bpm - truth) <= options.lockTolerance * truth)
+                        ++inTolerance;
+                }
+            for (double b : result.beats)
+                if (b >= lock && b < to)
+                    phaseErrors.push_back (1000.0 * nearestDistance (signal.beats, b));
+            for (double b : signal.beats)
+                if (b >= lock && b < to)
+                {
+                    ++trueBeats;
+                    if (nearestDistance (result.beats, b) <= options.beatToleranceSec)
+                        ++hitBeats;
+                }
+        }
+        s.bpmErrorPct = median (bpmErrors);
+        s.inTolerancePct = bpmErrors.empty() ? 0.0 : 100.0 * inTolerance / (double) bpmErrors.size();
+        s.phaseMs = median (phaseErrors);
+        s.beatsPct = trueBeats > 0 ? 100.0 * hitBeats / trueBeats : 0.0;
+        return s;
+    }
+
+    void printTime (std::ostream& out, int width, double seconds)
+    {
+        if (seconds < 0.0)
+            out << std::setw (width) << "-";
+        else
+            out << std::setw (width) << std::setprecision (2) << seconds;
+    }
+
+    // The limits a score breaks, space separated; empty when it passes
+    std::string failedLimits (const SignalScore& s, const SignalLimits& limits)
+    {
+        std::string failed;
+        auto fail = [&failed] (const char* what) { failed += failed.empty() ? what : std::string (" ") + what; };
+        if (s.lockSec < 0.0 || (limits.maxLockSec >= 0.0 && s.lockSec > limits.maxLockSec))
+            fail ("lock");
+        if (s.hasChange && limits.maxRelockSec >= 0.0 && (s.relockSec < 0.0 || s.relockSec > limits.maxRelockSec))
+            fail ("relock");
+        if (limits.maxBpmErrorPct >= 0.0 && s.bpmErrorPct > limits.maxBpmErrorPct)
+            fail ("bpm_err");
+        if (limits.maxOctavePct >= 0.0 && s.octavePct > limits.maxOctavePct)
+            fail ("octave");
+        return failed;
+    }
+}
+
+int runAccuracyTest (const AccuracyTestOptions& options, std::ostream& out)
+{
+    // One core, so cpu_ms/s is comparable between machines with different core counts
+    WorkStealingPool pool (0);
+    const auto specs = getStandardTestSignals (options.secondsPerSignal);
+
+    out << "Accuracy test: " << specs.size() << " signals, " << options.secondsPerSignal << " s each at "
+        << options.sampleRate << " Hz, lock within " << 100.0 * options.lockTolerance << "% for "
+        << options.lockHoldSec << " s" << std::endl;
+    out << "signal          bpm_err_%  octave_%  in_tol_%  lock_s  relock_s  phase_ms  beats_%  cpu_ms/s" << std::endl;
+
+    int failures = 0, expectedFailures = 0;
+    double sumBpmError = 0.0, sumPhase = 0.0, sumBeats = 0.0, sumCpu = 0.0, worstLock = 0.0;
+    for (const auto& spec : specs)
+    {
+        const auto signal = renderTestSignal (spec, options.secondsPerSignal, options.sampleRate);
+        const auto result = analyseSamples (signal.samples.data(), (juce::int64) signal.samples.size(), signal.sampleRate, pool);
+        const auto limits = limitsFor (spec.name);
+        const auto s = score (signal, result, options, limits.acceptOctave);
+        const auto failed = failedLimits (s, limits);
+        const bool expected = limits.expectedFailure != nullptr;
+
+        out << std::left << std::setw (14) << spec.name.toStdString() << std::right << std::fixed
+            << std::setw (11) << std::setprecision (2) << s.bpmErrorPct
+            << std::setw (10) << std::setprecision (1) << s.octavePct
+            << std::setw (10) << std::setprecision (1) << s.inTolerancePct;
+        printTime (out, 8, s.lockSec);
+        if (s.hasChange)
+            printTime (out, 10, s.relockSec);
+        else
+            out << std::setw (10) << "-";
+        out << std::setw (10) << std::setprecision (1) << s.phaseMs
+            << std::setw (9) << std::setprecision (1) << s.beatsPct
+            << std::setw (10) << std::setprecision (2) << s.cpuMsPerSec
+            << (s.locked ? "" : "  NO LOCK");
+        if (expected && failed == limits.expectedFailure)
+        {
+            out << "  XFAIL: " << failed << " (known miss)" << std::endl;
+            ++expectedFailures;
+        }
+        else
+        {
+            if (expected && failed.empty())
+                out << "  XPASS: passes now; drop its expected failure (" << limits.expectedFailure << ")";
+            else if (! failed.empty())
+                out << "  FAIL: " << failed;
+            out << std::endl;
+            if (expected || ! failed.empty())
+                ++failures;
+        }
+        sumBpmError += s.bpmErrorPct;
+        sumPhase += s.phaseMs;
+        sumBeats += s.beatsPct;
+        sumCpu += s.cpuMsPerSec;
+        worstLock = juce::jmax (worstLock, s.lockSec, s.relockSec);
+    }
+
+    const double n = (double) juce::jmax<size_t> (1, specs.size());
+    out << "Passed " << (int) specs.size() - failures - expectedFailures << "/" << specs.size()
+        << " (" << expectedFailures << " expected " << (expectedFailures == 1 ? "failure" : "failures") << ")" << std::fixed
+        << ", mean bpm error " << std::setprecision (2) << sumBpmError / n << "%"
+        << ", slowest lock " << worstLock << " s"
+        << ", mean phase error " << std::setprecision (1) << sumPhase / n << " ms"
+        << ", beats " << sumBeats / n << "%"
+        << ", " << std::setprecision (2) << sumCpu / n << " ms CPU per s of audio" << std::endl;
+    return failures;
+}
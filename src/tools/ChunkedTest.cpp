@@ -0,0 +1,89 @@
+#include "ChunkedTest.h"
+#include "core/OfflineAnalysis.h"
+#include "TestSignals.h"
+#include <algorithm>
+#include <iomanip>
+#include <thread>
+
+namespace
+{
+    // One fine STFT hop (AnalysisPipeline::prepare): chunk starts sit on the frame alignment,
+    // so a settled chunk puts its frames, and with them every event, on the sequential pass's
+    // samples; an event may still land one frame apart where a detector's threshold is borderline
+    constexpr double hopToleranceSec = 0.005;
+    constexpr double bpmTolerance = 0.0;
+    constexpr double tempoStepSec = 0.1; // compareResults samples the tempo curves this often
+
+    bool matches (const OfflineComparison& c)
+    {
+        return c.onsetsMatched == c.onsetsCompared && c.beatsMatched == c.beatsCompared
+            && c.bpmSamplesMatched == c.bpmSamples;
+    }
+}
+
+int runChunkedTest (const ChunkedTestOptions& options, std::ostream& out)
+{
+    ChunkedAnalysisOptions chunking;
+    chunking.chunkSec = options.chunkSec;
+    chunking.minChunkSec = options.chunkSec;
+    chunking.warmUpSec = options.warmUpSec;
+    chunking.sharedSec = options.sharedSec;
+
+    WorkStealingPool singleCore (0);
+    const auto specs = getStandardTestSignals (options.secondsPerSignal);
+
+    out << "Chunked test: " << specs.size() << " signals, " << options.secondsPerSignal << " s each, "
+        << options.chunkSec << " s chunks with " << options.warmUpSec << " s warm-up and " << options.sharedSec
+        << " s shared; onsets and beats within " << 1000.0 * hopToleranceSec << " ms, bpm every "
+        << tempoStepSec << " s exact" << std::endl;
+    out << "signal          seams  unmatched  onsets  onset_err_ms  beats  bpm_err" << std::endl;
+
+    int failures = 0;
+    for (const auto& spec : specs)
+    {
+        const auto signal = renderTestSignal (spec, options.secondsPerSignal, options.sampleRate);
+        const auto numSamples = (juce::int64) signal.samples.size();
+        const auto sequential = analyseSamples (signal.samples.data(), numSamples, signal.sampleRate, singleCore);
+        const auto chunked = analyseSamplesChunked (signal.samples.data(), numSamples, signal.sampleRate, chunking);
+        const auto c = compareResults (sequential, chunked, hopToleranceSec, bpmTolerance);
+        const bool ok = matches (c);
+
+        out << std::left << std::setw (14) << spec.name.toStdString() << std::right << std::fixed
+            << std::setw (7) << chunked.numSeams << std::setw (11) << chunked.unmatchedSeams
+            << std::setw (4) << c.onsetsMatched << "/" << std::left << std::setw (4) << c.onsetsCompared << std::right
+            << std::setw (12) << std::setprecision (1) << 1000.0 * c.maxOnsetErrorSec
+            << std::setw (5) << c.beatsMatched << "/" << std::left << std::setw (4) << c.beatsCompared << std::right
+            << std::setw (9) << std::setprecision (2) << c.maxBpmError
+            << (ok ? "" : "  MISMATCH") << std::endl;
+        if (! ok)
+            ++failures;
+    }
+    out << "Matched " << (int) specs.size() - failures << "/" << (int) specs.size() << " signals" << std::endl;
+
+    if (options.scalingSec > 0.0)
+    {
+        TestSignalSpec spec;
+        spec.name = "drums-128";
+        spec.bpm = 128.0;
+        const auto signal = renderTestSignal (spec, options.scalingSec, options.sampleRate);
+        const auto numSamples = (juce::int64) signal.samples.size();
+        const auto sequential = analyseSamples (signal.samples.data(), numSamples, signal.sampleRate, singleCore);
+
+        const int cores = juce::jmax (1, (int) std::thread::hardware_concurrency());
+        out << "Scaling: " << options.scalingSec << " s drum loop, sequential " << std::setprecision (2)
+            << sequential.processingSec << " s on one core (" << cores << " cores)" << std::endl;
+        out << "threads  chunks  seconds  speed-up" << std::endl;
+        for (int threads = 1;; threads = juce::jmin (threads * 2, cores))
+        {
+            ChunkedAnalysisOptions scaling;
+            scaling.numThreads = threads;
+            const auto chunked = analyseSamplesChunked (signal.samples.data(), numSamples, signal.sampleRate, scaling);
+            out << std::setw (7) << threads << std::setw (8) << chunked.numSeams + 1
+                << std::setw (9) << std::setprecision (2) << chunked.processingSec
+                << std::setw (9) << sequential.processingSec / juce::jmax (1.0e-9, chunked.processingSec) << "x" << std::endl;
+            if (threads >= cores)
+                break;
+        }
+    }
+    return failures;
+}
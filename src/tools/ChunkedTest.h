@@ -0,0 +1,24 @@
+#pragma once
+
+#include <ostream>
+
+// Checks that chunk-parallel analysis (analyseSamplesChunked) reproduces a sequential pass.
+// Each standard test signal (TestSignals.h) is analysed both ways with short chunks, so every
+// signal crosses several seams, and must match on onsets, beats and the tempo curve within
+// one fine STFT hop (5 ms) and exactly on BPM; on the sparse noise-masked loops that relies on
+// the chunker extending warm-ups to the tempo estimator's 64-onset memory. A long drum loop is
+// then analysed with 1, 2, 4... threads up to the core count
+// to measure the speed-up over the sequential pass.
+struct ChunkedTestOptions
+{
+    double secondsPerSignal { 150.0 };
+    double sampleRate { 48000.0 };
+    double chunkSec { 30.0 };          // short, for several seams per signal
+    double warmUpSec { 30.0 };
+    double sharedSec { 10.0 };
+    double scalingSec { 600.0 };       // length of the thread-scaling run; 0 skips it
+};
+
+// Prints one line per signal and the scaling table to out; returns the number of signals
+// whose chunked result departs from the sequential one
+int runChunkedTest(const ChunkedTestOptions& options, std::ostream& out);
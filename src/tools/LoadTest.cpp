@@ -0,0 +1,156 @@
+#include "LoadTest.h"
+#include "core/AnalysisPipeline.h"
+#include <cmath>
+#include <iomanip>
+#include <random>
+
+namespace
+{
+    constexpr int packetFrames = 480;   // 10 ms at 48 kHz, a typical WASAPI packet
+    constexpr int channels = 2;
+    constexpr double maxFeederLagMs = 50.0;
+
+    constexpr double loopSeconds = 8.0;
+
+    // Four bars at 120 BPM, stereo interleaved: kick on the beat, hats on the off-beats, noise bed.
+    // One extra packet repeats the start so any packet can be read without wrapping.
+    std::vector<float> makeDrumLoop (double sampleRate)
+    {
+        const int frames = (int) (sampleRate * loopSeconds) + packetFrames;
+        std::vector<float> loop ((size_t) frames * channels);
+        std::mt19937 rng (1u);
+        std::uniform_real_distribution<float> noise (-1.0f, 1.0f);
+        const int beat = (int) (sampleRate * 0.5);
+        for (int j = 0; j < frames; ++j)
+        {
+            const int i = j % (int) (sampleRate * loopSeconds);
+            const int inBeat = i % beat;
+            const double kickT = inBeat / sampleRate;
+            float v = 0.8f * (float) (std::exp (-kickT * 30.0) * std::sin (2.0 * juce::MathConstants<double>::pi * 60.0 * kickT));
+            const int inOffbeat = (i + beat / 2) % beat;
+            if (inOffbeat < (int) (sampleRate * 0.03))
+                v += 0.3f * noise (rng) * (float) std::exp (-(inOffbeat / sampleRate) * 120.0);
+            v += 0.02f * noise (rng);
+            loop[(size_t) j * channels] = v;
+            loop[(size_t) j * channels + 1] = v;
+        }
+        return loop;
+    }
+
+    struct StepResult
+    {
+        bool sustained { false };
+        uint64_t droppedSamples { 0 };
+        double worstBacklogMs { 0.0 };
+        double worstFeederLagMs { 0.0 };
+        double dspLoad { 0.0 };         // mean per stream: DSP time per chunk / chunk duration
+        double meanBpm { 0.0 };
+    };
+
+    StepResult runStep (WorkStealingPool& pool, int numStreams, const LoadTestOptions& options, const std::vector<float>& loop)
+    {
+        std::vector<std::unique_ptr<AnalysisPipeline>> streams;
+        for (int i = 0; i < numStreams; ++i)
+        {
+            auto stream = std::make_unique<AnalysisPipeline> (pool, "/load" + juce::String (i));
+            stream->getCaptureFifo().setAutoGrow (false);
+            stream->prepare (options.sampleRate);
+            stream->start();
+            streams.push_back (std::move (stream));
+        }
+
+        // Real-time pace on absolute deadlines; each stream starts on a different beat of the loop
+        StepResult result;
+        const int loopFrames = (int) (options.sampleRate * loopSeconds);
+        const int numPackets = (int) (options.secondsPerStep * options.sampleRate / packetFrames);
+        const double packetMs = 1000.0 * packetFrames / options.sampleRate;
+        const double startMs = juce::Time::getMillisecondCounterHiRes();
+        for (int p = 0; p < numPackets; ++p)
+        {
+            const double dueMs = startMs + p * packetMs;
+            double nowMs = juce::Time::getMillisecondCounterHiRes();
+            if (dueMs - nowMs >= 1.0)
+                juce::Thread::sleep ((int) (dueMs - nowMs));
+            nowMs = juce::Time::getMillisecondCounterHiRes();
+            result.worstFeederLagMs = juce::jmax (result.worstFeederLagMs, nowMs - dueMs);
+
+            for (int s = 0; s < numStreams; ++s)
+            {
+                const int first = (p * packetFrames + (s % 16) * (loopFrames / 16)) % loopFrames;
+                streams[(size_t) s]->pushAudio (loop.data() + (size_t) first * channels, packetFrames, channels, options.sampleRate);
+            }
+        }
+
+        // Give the DSP threads one packet's time to take the last writes, then read the results
+        juce::Thread::sleep ((int) std::ceil (packetMs));
+        int bpmCount = 0;
+        const double chunkUs = 1.0e6 * AnalysisPipeline::dspChunkSize / options.sampleRate;
+        for (auto& stream : streams)
+        {
+            const auto stats = stream->getCaptureFifo().getStats();
+            result.droppedSamples += stats.samplesDropped;
+            result.worstBacklogMs = juce::jmax (result.worstBacklogMs, 1000.0 * stats.highWatermark / options.sampleRate);
+            result.dspLoad += (stream->getStftTimings().getAverageWallUs() + stream->getDetectorTimings().getAverageWallUs()) / chunkUs;
+            const auto snap = stream->getSnapshot();
+            if (snap.bpm > 0.0)
+            {
+                result.meanBpm += snap.bpm;
+                ++bpmCount;
+            }
+        }
+        result.dspLoad /= juce::jmax (1, numStreams);
+        result.meanBpm = bpmCount > 0 ? result.meanBpm / bpmCount : 0.0;
+
+        const int capacity = streams.front()->getCaptureFifo().getCapacity();
+        result.sustained = result.droppedSamples == 0
+                        && result.worstBacklogMs * options.sampleRate / 1000.0 <= 0.5 * capacity
+                        && result.worstFeederLagMs <= maxFeederLagMs;
+
+        for (auto& stream : streams)
+            stream->stop();
+        return result;
+    }
+}
+
+int runLoadTest (const LoadTestOptions& options, std::ostream& out)
+{
+    WorkStealingPool pool;
+    const auto loop = makeDrumLoop (options.sampleRate);
+
+    out << "Load test: " << options.secondsPerStep << " s per step at " << options.sampleRate << " Hz, "
+        << pool.getNumWorkers() << " pool workers" << std::endl;
+    out << "streams  result  backlog_ms  dropped  dsp_load  feeder_lag_ms  bpm" << std::endl;
+
+    auto step = [&] (int n)
+    {
+        const auto r = runStep (pool, n, options, loop);
+        out << std::setw (7) << n << "  " << (r.sustained ? "ok    " : "behind")
+            << std::fixed << std::setprecision (1)
+            << std::setw (12) << r.worstBacklogMs << std::setw (9) << r.droppedSamples
+            << std::setw (9) << std::setprecision (3) << r.dspLoad
+            << std::setw (15) << std::setprecision (1) << r.worstFeederLagMs
+            << std::setw (7) << r.meanBpm << std::endl;
+        return r.sustained;
+    };
+
+    int good = 0, bad = options.maxStreams + 1;
+    for (int n = 1; n <= options.maxStreams; n = n < options.maxStreams ? juce::jmin (2 * n, options.maxStreams) : n + 1)
+    {
+        if (! step (n)) { bad = n; break; }
+        good = n;
+    }
+    if (good > 0 && bad <= options.maxStreams)
+    {
+        while (bad - good > 1)
+        {
+            const int mid = (good + bad) / 2;
+            if (step (mid)) good = mid; else bad = mid;
+        }
+    }
+
+    out << "Sustained " << good << " concurrent stream" << (good == 1 ? "" : "s") << " in real time";
+    if (good >= options.maxStreams)
+        out << " (test limit)";
+    out << std::endl;
+    return good;
+}
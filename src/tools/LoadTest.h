@@ -0,0 +1,18 @@
+#pragma once
+
+#include <ostream>
+
+// Finds how many AnalysisPipeline streams this machine analyses in real time. Each step runs N
+// pipelines side by side on one shared pool, fed with a synthetic drum loop at the real capture
+// pace (10 ms stereo packets), and checks that none of them fell behind: no samples dropped,
+// capture FIFO backlog under half its capacity, and the feeder itself kept its schedule.
+// N doubles until a step fails, then bisects between the last good and the first bad count.
+struct LoadTestOptions
+{
+    double secondsPerStep { 5.0 };
+    int maxStreams { 64 };
+    double sampleRate { 48000.0 };
+};
+
+// Prints one line per step and a summary to out; returns the largest sustained stream count
+int runLoadTest (const LoadTestOptions& options, std::ostream& out);
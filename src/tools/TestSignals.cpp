@@ -0,0 +1,203 @@
+#include "TestSignals.h"
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+namespace
+{
+    constexpr double firstBeatSec = 0.25;
+
+    double tempoAt (const TestSignalSpec& spec, double t, double durationSec)
+    {
+        if (spec.endBpm <= 0.0)
+            return spec.bpm;
+        if (spec.changeSec >= 0.0)
+            return t < spec.changeSec ? spec.bpm : spec.endBpm;
+        return spec.bpm + (spec.endBpm - spec.bpm) * juce::jlimit (0.0, 1.0, t / durationSec);
+    }
+
+    // Beat times from the tempo curve, integrated per sample
+    std::vector<double> makeBeats (const TestSignalSpec& spec, double durationSec, double sampleRate)
+    {
+        std::vector<double> beats;
+        double phase = 0.0;
+        const double dt = 1.0 / sampleRate;
+        for (juce::int64 n = 0;; ++n)
+        {
+            const double t = firstBeatSec + (double) n * dt;
+            if (t >= durationSec)
+                break;
+            if (phase <= 0.0)
+            {
+                beats.push_back (t);
+                phase += 1.0;
+            }
+            phase -= tempoAt (spec, t, durationSec) / 60.0 * dt;
+        }
+        return beats;
+    }
+
+    // Adds a voice starting at timeSec; voice(t) is its signal t seconds after the start
+    template <typename Voice>
+    void addVoice (std::vector<float>& out, double sampleRate, double timeSec, double lengthSec, Voice&& voice)
+    {
+        const auto first = (size_t) std::llround (timeSec * sampleRate);
+        const auto length = (size_t) (lengthSec * sampleRate);
+        for (size_t i = 0; i < length && first + i < out.size(); ++i)
+            out[first + i] += voice ((double) i / sampleRate);
+    }
+}
+
+double TestSignal::bpmAt (double timeSec) const
+{
+    if (beats.size() < 2)
+        return -1.0;
+    auto next = std::upper_bound (beats.begin(), beats.end(), timeSec);
+    if (next == beats.begin())
+        ++next;
+    if (next == beats.end())
+        --next;
+
+    // An interval spanning an abrupt change belongs to neither tempo: use its neighbour on
+    // timeSec's side of the change
+    for (double change : tempoChanges)
+    {
+        if (*(next - 1) < change && change < *next)
+        {
+            if (timeSec < change && next - 1 != beats.begin())
+                --next;
+            else if (timeSec >= change && next + 1 != beats.end())
+                ++next;
+            break;
+        }
+    }
+    return 60.0 / (*next - *(next - 1));
+}
+
+TestSignal renderTestSignal (const TestSignalSpec& spec, double durationSec, double sampleRate, unsigned seed)
+{
+    TestSignal signal;
+    signal.name = spec.name;
+    signal.sampleRate = sampleRate;
+    signal.samples.assign ((size_t) (durationSec * sampleRate), 0.0f);
+    signal.beats = makeBeats (spec, durationSec, sampleRate);
+    if (spec.endBpm > 0.0 && spec.changeSec >= 0.0)
+        signal.tempoChanges.push_back (spec.changeSec);
+
+    std::mt19937 rng (seed);
+    std::uniform_real_distribution<float> white (-1.0f, 1.0f);
+    const double twoPi = juce::MathConstants<double>::twoPi;
+    auto& out = signal.samples;
+
+    for (size_t i = 0; i < signal.beats.size(); ++i)
+    {
+        const double beat = signal.beats[i];
+        const bool downbeat = i % 4 == 0;
+        if (spec.kind == TestSignalSpec::Kind::ClickTrack)
+        {
+            const double freq = downbeat ? 1500.0 : 1000.0;
+            addVoice (out, sampleRate, beat, 0.02, [&] (double t) { return (float) (0.6 * std::exp (-t * 200.0) * std::sin (twoPi * freq * t)); });
+            continue;
+        }
+
+        const double interval = i + 1 < signal.beats.size() ? signal.beats[i + 1] - beat
+                                                            : 60.0 / tempoAt (spec, beat, durationSec);
+        if (i % 2 == 0)
+        {
+            // Kick: 110 -> 50 Hz sweep
+            addVoice (out, sampleRate, beat, 0.25, [&] (double t)
+            {
+                const double phase = twoPi * (50.0 * t + 60.0 / 30.0 * (1.0 - std::exp (-t * 30.0)));
+                return (float) (0.8 * std::exp (-t * 18.0) * std::sin (phase));
+            });
+        }
+        else
+        {
+            // Snare: noise burst over a 190 Hz body
+            addVoice (out, sampleRate, beat, 0.15, [&] (double t)
+            {
+                return (float) (std::exp (-t * 30.0) * (0.35 * white (rng) + 0.3 * std::sin (twoPi * 190.0 * t)));
+            });
+        }
+
+        // Closed hats on the beat and the (swung) off-beat: differenced noise is bright
+        for (double at : { beat, beat + spec.swing * interval })
+        {
+            float last = 0.0f;
+            addVoice (out, sampleRate, at, 0.04, [&] (double t)
+            {
+                const float n = white (rng);
+                const float hp = n - last;
+                last = n;
+                return (float) (0.12 * std::exp (-t * 110.0)) * hp;
+            });
+        }
+    }
+
+    if (std::isfinite (spec.noiseSnrDb))
+    {
+        // Pink noise (Paul Kellet's economy filter) scaled to the music's RMS minus the SNR
+        double musicPower = 0.0;
+        for (auto v : out)
+            musicPower += (double) v * v;
+        const double musicRms = std::sqrt (musicPower / juce::jmax<size_t> (1, out.size()));
+
+        std::vector<float> noise (out.size());
+        float b0 = 0.0f, b1 = 0.0f, b2 = 0.0f;
+        double noisePower = 0.0;
+        for (auto& v : noise)
+        {
+            const float w = white (rng);
+            b0 = 0.99765f * b0 + w * 0.0990460f;
+            b1 = 0.96300f * b1 + w * 0.2965164f;
+            b2 = 0.57000f * b2 + w * 1.0526913f;
+            v = b0 + b1 + b2 + w * 0.1848f;
+            noisePower += (double) v * v;
+        }
+        const double noiseRms = std::sqrt (noisePower / juce::jmax<size_t> (1, noise.size()));
+        const auto gain = (float) (musicRms * std::pow (10.0, -spec.noiseSnrDb / 20.0) / juce::jmax (1.0e-9, noiseRms));
+        for (size_t i = 0; i < out.size(); ++i)
+            out[i] += gain * noise[i];
+    }
+
+    // Keep clear of clipping without changing the relative levels
+    float peak = 0.0f;
+    for (auto v : out)
+        peak = juce::jmax (peak, std::abs (v));
+    if (peak > 0.95f)
+        for (auto& v : out)
+            v *= 0.95f / peak;
+    return signal;
+}
+
+std::vector<TestSignalSpec> getStandardTestSignals (double durationSec)
+{
+    using Kind = TestSignalSpec::Kind;
+    std::vector<TestSignalSpec> specs;
+    specs.reserve (16);
+    auto add = [&specs] (const char* name, Kind kind, double bpm) -> TestSignalSpec&
+    {
+        specs.push_back ({});
+        auto& s = specs.back();
+        s.name = name;
+        s.kind = kind;
+        s.bpm = bpm;
+        return s;
+    };
+
+    add ("click-120", Kind::ClickTrack, 120.0);
+    add ("drums-95", Kind::DrumLoop, 95.0);
+    add ("drums-128", Kind::DrumLoop, 128.0);
+    add ("drums-174", Kind::DrumLoop, 174.0);
+    add ("ramp-100-140", Kind::DrumLoop, 100.0).endBpm = 140.0;
+    auto& up = add ("step-120-150", Kind::DrumLoop, 120.0);
+    up.endBpm = 150.0;
+    up.changeSec = 0.5 * durationSec;
+    auto& down = add ("step-128-100", Kind::DrumLoop, 128.0);
+    down.endBpm = 100.0;
+    down.changeSec = 0.5 * durationSec;
+    add ("swing-110", Kind::DrumLoop, 110.0).swing = 0.66;
+    add ("noise-120-6db", Kind::DrumLoop, 120.0).noiseSnrDb = 6.0;
+    add ("noise-140-0db", Kind::DrumLoop, 140.0).noiseSnrDb = 0.0;
+    return specs;
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <limits>
+#include <vector>
+
+// Synthetic material with a known beat grid, for measuring how well and how fast the pipeline
+// finds it. Beats follow the spec's tempo curve: constant, a linear ramp over the whole signal,
+// or an abrupt change at changeSec.
+struct TestSignalSpec
+{
+    enum class Kind
+    {
+        ClickTrack, // short tone on every beat, accented downbeats
+        DrumLoop    // kick on 1 and 3, snare on 2 and 4, hats on the eighths
+    };
+
+    juce::String name;
+    Kind kind { Kind::DrumLoop };
+    double bpm { 120.0 };
+    double endBpm { -1.0 };       // > 0: tempo at the end (ramp) or after changeSec (step)
+    double changeSec { -1.0 };    // >= 0: abrupt change to endBpm here instead of a ramp
+    double swing { 0.5 };         // off-beat eighths at this fraction of the beat (0.5 straight)
+    double noiseSnrDb { std::numeric_limits<double>::infinity() }; // pink noise this far below the music
+};
+
+struct TestSignal
+{
+    juce::String name;
+    double sampleRate { 0.0 };
+    std::vector<float> samples;        // mono
+    std::vector<double> beats;         // true beat times, seconds
+    std::vector<double> tempoChanges;  // abrupt tempo changes, seconds
+
+    // True tempo at t: from the beat interval around it
+    double bpmAt(double timeSec) const;
+};
+
+TestSignal renderTestSignal(const TestSignalSpec& spec, double durationSec, double sampleRate, unsigned seed = 1u);
+
+// Click track, drum loops at slow/mid/fast tempi, a ramp, step changes up and down halfway
+// through, swing and two noise-masked loops
+std::vector<TestSignalSpec> getStandardTestSignals(double durationSec);
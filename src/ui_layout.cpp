@@ -1,8 +1,78 @@
 #include "MainComponent.h"
 
+void MainComponent::setUiRateHz (int hz)
+{
+    uiRateHz.store (juce::jlimit (1, 240, hz));
+}
+
+void MainComponent::setAnalysisRateHz (int hz)
+{
+    for (auto& stream : streams)
+        stream->setAnalysisRateHz (hz);
+}
+
+// UI refresh: only reads the analysis snapshot. While the window is minimised the timer slows
+// to minimisedUiRateHz; analysis and output are unaffected.
+void MainComponent::timerCallback()
+{
+    auto* peer = getPeer();
+    const bool minimised = peer != nullptr && peer->isMinimised();
+    const int wantedHz = minimised ? minimisedUiRateHz : uiRateHz.load();
+    if (getTimerInterval() != 1000 / wantedHz)
+        startTimerHz (wantedHz);
+    if (minimised)
+        return;
+
+    const auto& stream = primaryStream();
+    if (stream.getSnapshotVersion() == lastUiSnapshotVersion)
+        return;
+    lastUiSnapshotVersion = stream.getSnapshotVersion();
+    uiSnapshot = stream.getSnapshot();
+    const auto& snap = uiSnapshot;
+
+    if (snap.bpm > 0)
+        bpmLabel.setText ("BPM: " + juce::String (snap.bpm, 1), juce::dontSendNotification);
+    else
+        bpmLabel.setText ("BPM: --", juce::dontSendNotification);
+    confLabel.setText ("Conf: " + juce::String (snap.confidence, 2), juce::dontSendNotification);
+
+    if (snap.nextBeatSec > 0)
+        beatLabel.setText ("Next beat: " + juce::String (snap.nextBeatSec, 2) + " s", juce::dontSendNotification);
+    else
+        beatLabel.setText ("Beat: --", juce::dontSendNotification);
+    repaint();
+}
+
 void MainComponent::paint (juce::Graphics& g)
 {
     g.fillAll (juce::Colours::black);
+    if (activityArea.isEmpty())
+        return;
+
+    // Beat phase: a bar that fills over each beat, brightest right after the beat
+    auto area = activityArea;
+    auto phaseRow = area.removeFromTop (12).toFloat();
+    const auto phase = (float) juce::jlimit (0.0, 1.0, uiSnapshot.beatPhase);
+    g.setColour (juce::Colours::darkgrey);
+    g.drawRect (phaseRow);
+    if (uiSnapshot.bpm > 0)
+    {
+        g.setColour (juce::Colours::orange.withAlpha (1.0f - 0.7f * phase));
+        g.fillRect (phaseRow.withWidth (phaseRow.getWidth() * phase));
+    }
+
+    // Onset activity per band, lowest band on the left
+    area.removeFromTop (6);
+    const auto& bands = uiSnapshot.bandActivity;
+    const int barWidth = area.getWidth() / (int) bands.size();
+    for (size_t b = 0; b < bands.size(); ++b)
+    {
+        auto bar = area.removeFromLeft (barWidth).reduced (2, 0).toFloat();
+        g.setColour (juce::Colours::darkgrey);
+        g.drawRect (bar);
+        g.setColour (juce::Colours::limegreen);
+        g.fillRect (bar.removeFromBottom (bar.getHeight() * juce::jlimit (0.0f, 1.0f, bands[b])));
+    }
 }
 
 void MainComponent::resized()
@@ -44,6 +114,9 @@ void MainComponent::resized()
         lpfSlider.setBounds (row4.removeFromLeft (160));
         showCandToggle.setBounds (row4.removeFromLeft (140));
     }
+
+    r.removeFromTop (8);
+    activityArea = r.removeFromTop (80).withWidth (jmin (r.getWidth(), 400));
 }
 
 
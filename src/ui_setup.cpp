@@ -108,9 +108,17 @@ void MainComponent::setupMidiUI()
         auto devices = juce::MidiOutput::getAvailableDevices();
         if (idx >= 0 && idx < devices.size())
         {
+            // Close the current device before opening, some drivers allow one client only
+            primaryStream().setMidiSender (nullptr);
             midiOut.reset();
             midiOut = juce::MidiOutput::openDevice (devices[(int) idx].identifier);
-            if (midiOut)
+            const bool ok = midiOut != nullptr;
+            if (ok)
+            {
+                auto* device = midiOut.get();
+                primaryStream().setMidiSender ([device] (const juce::MidiBuffer& buffer) { device->sendBlockOfMessagesNow (buffer); });
+            }
+            if (ok)
                 statusLabel.setText ("MIDI connected: " + devices[(int) idx].name, juce::dontSendNotification);
             else
                 statusLabel.setText ("Failed to open MIDI: " + devices[(int) idx].name, juce::dontSendNotification);
@@ -129,9 +137,10 @@ void MainComponent::setupPrefilterControls()
     hpfSlider.setValue (20.0, juce::dontSendNotification);
     hpfSlider.onValueChange = [this]
     {
-        if (currentSampleRate.load() > 0.0)
-            bandFilter.get<0>().coefficients = juce::dsp::IIR::Coefficients<float>::makeHighPass ((double) currentSampleRate.load(), (float) hpfSlider.getValue());
+        for (auto& stream : streams)
+            stream->setHighPassHz ((float) hpfSlider.getValue());
     };
+    hpfSlider.onValueChange();
     addAndMakeVisible (lpfHint);
     lpfHint.setText ("LPF:", juce::dontSendNotification);
     lpfHint.setColour (juce::Label::textColourId, juce::Colours::silver);
@@ -140,27 +149,28 @@ void MainComponent::setupPrefilterControls()
     lpfSlider.setValue (6000.0, juce::dontSendNotification);
     lpfSlider.onValueChange = [this]
     {
-        if (currentSampleRate.load() > 0.0)
-            bandFilter.get<1>().coefficients = juce::dsp::IIR::Coefficients<float>::makeLowPass ((double) currentSampleRate.load(), (float) lpfSlider.getValue());
+        for (auto& stream : streams)
+            stream->setLowPassHz ((float) lpfSlider.getValue());
     };
+    lpfSlider.onValueChange();
 
     addAndMakeVisible (showCandToggle);
     showCandToggle.setToggleState (false, juce::dontSendNotification);
     showCandToggle.onClick = [this]
     {
-        sendTempoCandidates = showCandToggle.getToggleState();
+        primaryStream().setSendTempoCandidates (showCandToggle.getToggleState());
     };
 }
 
 void MainComponent::setupOSC()
 {
-    oscConnected = osc.connect ("127.0.0.1", 9000);
+    primaryStream().connectOsc ("127.0.0.1", 9000);
 }
 
 void MainComponent::startTimersAndThreads()
 {
-    startTimerHz (30);
-    startDspThread();
+    startTimerHz (uiRateHz.load());
+    primaryStream().start();
 }
 
 
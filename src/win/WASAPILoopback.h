@@ -9,6 +9,7 @@
 #include <wrl/client.h>
 #include <future>
 #include <JuceHeader.h>
+#include "../dsp/AllocationCounter.h"
 
 class WASAPILoopbackCapture
 {
@@ -240,7 +241,13 @@ public:
                 }
                 return (int) wf->wBitsPerSample;
             };
-            juce::HeapBlock<float> convertBuffer;
+            // Packets never exceed the endpoint buffer, so the conversion buffer is sized once here
+            UINT32 endpointFrames = 0;
+            if (FAILED (client->GetBufferSize (&endpointFrames)) || endpointFrames == 0)
+                endpointFrames = (UINT32) formatToUse->nSamplesPerSec; // 1 s fallback
+            size_t convertCapacity = (size_t) endpointFrames * (size_t) channels;
+            juce::HeapBlock<float> convertBuffer (convertCapacity, true);
+            int packetsSinceStart = 0;
 
             if (FAILED (client->Start()))
             {
@@ -254,10 +261,6 @@ public:
 
             finish (true);
 
-            LARGE_INTEGER qpcFreqLI { 0 };
-            QueryPerformanceFrequency (&qpcFreqLI);
-            const double qpcFreq = (qpcFreqLI.QuadPart > 0) ? (double) qpcFreqLI.QuadPart : 1.0;
-
             while (running)
             {
                 DWORD wait = WaitForSingleObject (hEvent, 2000);
@@ -269,17 +272,24 @@ public:
                 UINT32 packetFrames = 0;
                 if (cap->GetNextPacketSize (&packetFrames) == S_OK && packetFrames > 0)
                 {
+                    RealtimeSafety::ScopedRealtime realtime ("wasapi capture", ++packetsSinceStart > 16);
                     BYTE* data = nullptr; UINT32 numFrames = 0; DWORD flags = 0; UINT64 pos = 0; UINT64 qpc = 0;
                     if (SUCCEEDED (cap->GetBuffer (&data, &numFrames, &flags, &pos, &qpc)))
                     {
                         const bool isSilent = (flags & AUDCLNT_BUFFERFLAGS_SILENT) != 0;
                         const size_t numSamples = (size_t) numFrames * (size_t) channels;
                         const float* floatData = nullptr;
-                        const double qpcSeconds = (double) ((long double) qpc / (long double) qpcFreq);
+                        // GetBuffer reports the performance counter in 100 ns units, not ticks; 0 = no timestamp
+                        const double qpcSeconds = (flags & AUDCLNT_BUFFERFLAGS_TIMESTAMP_ERROR) != 0 ? 0.0 : (double) qpc * 1.0e-7;
+                        if (numSamples > convertCapacity && (isSilent || ! inputIsFloat))
+                        {
+                            // Not expected; grow rather than overrun (reported as an allocation)
+                            convertCapacity = numSamples;
+                            convertBuffer.allocate (convertCapacity, true);
+                        }
 
                         if (isSilent)
                         {
-                            convertBuffer.allocate (numSamples, true);
                             juce::FloatVectorOperations::clear (convertBuffer.get(), (int) numSamples);
                             floatData = convertBuffer.get();
                         }
@@ -290,7 +300,6 @@ public:
                         else
                         {
                             // Minimal PCM16 -> float32 conversion fallback
-                            convertBuffer.allocate (numSamples, true);
                             const int validBits = getValidBits (formatToUse);
                             if (validBits == 16)
                             {
@@ -0,0 +1,51 @@
+#include "dsp/WorkStealingPool.h"
+
+#if defined (_WIN32)
+ #ifndef NOMINMAX
+  #define NOMINMAX
+ #endif
+ #include <windows.h>
+#elif defined (__APPLE__)
+ #include <dispatch/dispatch.h>
+#else
+ #include <cerrno>
+ #include <semaphore.h>
+#endif
+
+// Only signal() runs on real-time threads; construction may allocate
+#if defined (_WIN32)
+PoolSemaphore::PoolSemaphore()                 { handle = CreateSemaphoreW (nullptr, 0, MAXLONG, nullptr); }
+PoolSemaphore::~PoolSemaphore()                { CloseHandle ((HANDLE) handle); }
+void PoolSemaphore::signal (int count) noexcept { if (count > 0) ReleaseSemaphore ((HANDLE) handle, count, nullptr); }
+void PoolSemaphore::wait() noexcept            { WaitForSingleObject ((HANDLE) handle, INFINITE); }
+#elif defined (__APPLE__)
+PoolSemaphore::PoolSemaphore()                 { handle = dispatch_semaphore_create (0); }
+PoolSemaphore::~PoolSemaphore()                { dispatch_release ((dispatch_semaphore_t) handle); }
+void PoolSemaphore::signal (int count) noexcept
+{
+    for (int i = 0; i < count; ++i)
+        dispatch_semaphore_signal ((dispatch_semaphore_t) handle);
+}
+void PoolSemaphore::wait() noexcept            { dispatch_semaphore_wait ((dispatch_semaphore_t) handle, DISPATCH_TIME_FOREVER); }
+#else
+PoolSemaphore::PoolSemaphore()
+{
+    auto* s = new sem_t;
+    sem_init (s, 0, 0);
+    handle = s;
+}
+PoolSemaphore::~PoolSemaphore()
+{
+    sem_destroy ((sem_t*) handle);
+    delete (sem_t*) handle;
+}
+void PoolSemaphore::signal (int count) noexcept
+{
+    for (int i = 0; i < count; ++i)
+        sem_post ((sem_t*) handle);
+}
+void PoolSemaphore::wait() noexcept
+{
+    while (sem_wait ((sem_t*) handle) != 0 && errno == EINTR) {}
+}
+#endif